@@ -42,6 +42,7 @@
 #include <fc/io/fstream.hpp>
 #include <fc/rpc/api_connection.hpp>
 #include <fc/rpc/websocket_api.hpp>
+#include <fc/rpc/binary_websocket_api.hpp>
 #include <fc/network/resolve.hpp>
 #include <fc/stacktrace.hpp>
 #include <fc/string.hpp>
@@ -214,10 +215,29 @@ namespace detail {
          _websocket_tls_server->start_accept();
       } FC_CAPTURE_AND_RETHROW() }
 
-      void on_connection( const fc::http::websocket_connection_ptr& c )
+      void reset_binary_websocket_server()
+      { try {
+         if( !_options->count("rpc-binary-endpoint") )
+            return;
+
+         _binary_websocket_server = std::make_shared<fc::http::websocket_server>();
+
+         _binary_websocket_server->on_connection([this]( const fc::http::websocket_connection_ptr& c ){ on_connection( c, true ); } );
+         auto rpc_binary_endpoint = _options->at("rpc-binary-endpoint").as<string>();
+         ilog("Configured binary websocket rpc to listen on ${ip}", ("ip", rpc_binary_endpoint));
+         auto endpoints = resolve_string_to_ip_endpoints( rpc_binary_endpoint );
+         FC_ASSERT( endpoints.size(), "rpc-binary-endpoint ${hostname} did not resolve", ("hostname", rpc_binary_endpoint) );
+         _binary_websocket_server->listen( endpoints[0] );
+         _binary_websocket_server->start_accept();
+      } FC_CAPTURE_AND_RETHROW() }
+
+      void on_connection( const fc::http::websocket_connection_ptr& c, bool binary = false )
       {
          std::shared_ptr< api_session_data > session = std::make_shared<api_session_data>();
-         session->wsc = std::make_shared<fc::rpc::websocket_api_connection>(*c);
+         if( binary )
+            session->wsc = std::make_shared<fc::rpc::binary_websocket_api_connection>(*c);
+         else
+            session->wsc = std::make_shared<fc::rpc::websocket_api_connection>(*c);
 
          for( const std::string& name : _public_apis )
          {
@@ -261,17 +281,19 @@ namespace detail {
 
          _shared_file_size = fc::parse_size( _options->at( "shared-file-size" ).as< string >() );
          ilog( "shared_file_size is ${n} bytes", ("n", _shared_file_size) );
+
+         chainbase::mapping_options mapping;
+         mapping.huge_pages = _options->count( "shared-file-huge-pages" );
+         mapping.prefault = _options->count( "shared-file-prefault" );
+         mapping.lock_bytes = fc::parse_size( _options->at( "shared-file-mlock" ).as< string >() );
+         mapping.numa_node = _options->at( "shared-file-numa-node" ).as< int32_t >();
+         _chain_db->set_mapping_options( mapping );
          bool read_only = _options->count( "read-only" );
          register_builtin_apis();
 
          if( _options->count("check-locks") )
             _chain_db->set_require_locking( true );
 
-         if( _options->count("shared-file-dir") )
-            _shared_dir = fc::path( _options->at("shared-file-dir").as<string>() );
-         else
-            _shared_dir = _data_dir / "blockchain";
-
          if( _options->count( "disable-get-block" ) )
             _self->_disable_get_block = true;
 
@@ -285,6 +307,11 @@ namespace detail {
                _chain_db->wipe(_data_dir / "blockchain", _shared_dir, true);
 
             _chain_db->set_flush_interval( _options->at("flush").as<uint32_t>() );
+            _chain_db->set_background_flush_rate( uint64_t( _options->at("flush-rate").as<uint32_t>() ) * 1024 * 1024 );
+            _chain_db->set_recent_transaction_cache_limit( _options->at("recent-trx-cache-size").as<uint32_t>() );
+            _chain_db->set_index_statistics_interval( _options->at("index-stats-interval").as<uint32_t>() );
+            _chain_db->set_shared_file_growth( fc::parse_size( _options->at( "shared-file-grow-threshold" ).as< string >() ),
+                                               fc::parse_size( _options->at( "shared-file-grow-size" ).as< string >() ) );
 
             flat_map<uint32_t,block_id_type> loaded_checkpoints;
             if( _options->count("checkpoint") )
@@ -345,6 +372,7 @@ namespace detail {
          {
             ilog( "Starting SigmaEngine node in read mode." );
             _chain_db->open( _data_dir / "blockchain", _shared_dir, SIGMAENGINE_INIT_SUPPLY, _shared_file_size, chainbase::database::read_only );
+            ilog( "Attached to shared memory as a read replica, writer has committed block ${n}", ("n", _chain_db->committed_revision()) );
 
             if( _options->count( "read-forward-rpc" ) )
             {
@@ -359,6 +387,15 @@ namespace detail {
             }
          }
          _chain_db->show_free_memory( true );
+         if( !_self->_read_only )
+            _chain_db->show_index_statistics();
+
+         const auto& mapping_stats = _chain_db->get_mapping_stats();
+         ilog( "Shared memory opened in ${t} ms (prefault ${p} ms) with ${minor} minor and ${major} major page faults, "
+               "${l} bytes locked, huge pages ${h}, NUMA node ${numa}",
+               ("t", mapping_stats.open_microseconds / 1000)("p", mapping_stats.prefault_microseconds / 1000)
+               ("minor", mapping_stats.minor_faults)("major", mapping_stats.major_faults)
+               ("l", mapping_stats.locked_bytes)("h", mapping_stats.huge_pages)("numa", mapping_stats.numa_node) );
 
          if( _options->count("api-user") )
          {
@@ -402,6 +439,7 @@ namespace detail {
 
          reset_websocket_server();
          reset_websocket_tls_server();
+         reset_binary_websocket_server();
       } FC_LOG_AND_RETHROW() }
 
       optional< api_access_info > get_api_access_info(const string& username)const
@@ -926,6 +964,7 @@ namespace detail {
       std::shared_ptr<graphene::net::node>             _p2p_network;
       std::shared_ptr<fc::http::websocket_server>      _websocket_server;
       std::shared_ptr<fc::http::websocket_tls_server>  _websocket_tls_server;
+      std::shared_ptr<fc::http::websocket_server>      _binary_websocket_server;
 
       std::map<string, std::shared_ptr<abstract_plugin> > _plugins_available;
       std::map<string, std::shared_ptr<abstract_plugin> > _plugins_enabled;
@@ -991,8 +1030,15 @@ void application::set_program_options(boost::program_options::options_descriptio
          ("checkpoint,c", bpo::value<vector<string>>()->composing(), "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints.")
          ("shared-file-dir", bpo::value<string>(), "Location of the shared memory file. Defaults to data_dir/blockchain")
          ("shared-file-size", bpo::value<string>()->default_value("54G"), "Size of the shared memory file. Default: 54G")
+         ("shared-file-grow-threshold", bpo::value<string>()->default_value("1G"), "Grow the shared memory file between blocks when less than this is free. 0 disables growing")
+         ("shared-file-grow-size", bpo::value<string>()->default_value("8G"), "How much to grow the shared memory file by, at least shared-file-grow-threshold")
+         ("shared-file-huge-pages", "Advise transparent huge pages for the shared memory file. For explicit huge pages put shared-file-dir on hugetlbfs")
+         ("shared-file-prefault", "Fault in every page of the shared memory file at startup")
+         ("shared-file-mlock", bpo::value<string>()->default_value("0"), "Lock this much of the start of the shared memory file, where the indexes live, into RAM")
+         ("shared-file-numa-node", bpo::value<int32_t>()->default_value(-1), "Prefer this NUMA node for the shared memory pages, which are faulted in at startup, -1 for no preference")
          ("rpc-endpoint", bpo::value<string>()->implicit_value("127.0.0.1:5020"), "Endpoint for websocket RPC to listen on")
          ("rpc-tls-endpoint", bpo::value<string>()->implicit_value("127.0.0.1:8089"), "Endpoint for TLS websocket RPC to listen on")
+         ("rpc-binary-endpoint", bpo::value<string>()->implicit_value("127.0.0.1:5024"), "Endpoint for websocket RPC using fc::raw encoded binary frames to listen on")
          ("read-forward-rpc", bpo::value<string>(), "Endpoint to forward write API calls to for a read node" )
          ("server-pem,p", bpo::value<string>()->implicit_value("server.pem"), "The TLS certificate file for this server")
          ("server-pem-password,P", bpo::value<string>()->implicit_value(""), "Password for this certificate")
@@ -1001,6 +1047,9 @@ void application::set_program_options(boost::program_options::options_descriptio
          ("enable-plugin", bpo::value< vector<string> >()->composing()->default_value(default_plugins, str_default_plugins), "Plugin(s) to enable, may be specified multiple times")
          ("max-block-age", bpo::value< int32_t >()->default_value(200), "Maximum age of head block when broadcasting tx via API")
          ("flush", bpo::value< uint32_t >()->default_value(100000), "Flush shared memory file to disk this many blocks")
+         ("flush-rate", bpo::value< uint32_t >()->default_value(128), "MiB per second of shared memory a background thread writes back. 0 flushes on the apply thread every flush blocks instead")
+         ("recent-trx-cache-size", bpo::value< uint32_t >()->default_value(200000), "Most recently seen transactions kept in memory to serve peers, fewer if blocks of the current maximum size hold fewer until they expire")
+         ("index-stats-interval", bpo::value< uint32_t >()->default_value(10000), "Log object counts, shared memory and undo stack sizes of the largest indexes this many blocks. 0 disables it")
          ("backtrace", bpo::value<string>()->default_value("yes"), "Whether to print backtrace on SIGSEGV")
          ("black-list", bpo::value<vector<string>>()->composing(), "black-list account")
          ;
@@ -1009,7 +1058,7 @@ void application::set_program_options(boost::program_options::options_descriptio
          ("replay-blockchain", "Rebuild object graph by replaying all blocks")
          ("resync-blockchain", "Delete all blocks and re-sync with network from scratch")
          ("force-validate", "Force validation of all transactions")
-         ("read-only", "Node will not connect to p2p network and can only read from the chain state" )
+         ("read-only", "Node will not connect to p2p network and serves APIs from the chain state of a writer using the same shared-file-dir. Broadcasts go to read-forward-rpc" )
          ("check-locks", "Check correctness of chainbase locking")
          ("disable-get-block", "Disable get_block API call" )
          ;
@@ -1021,6 +1070,11 @@ void application::initialize(const fc::path& data_dir, const boost::program_opti
 {
    my->_data_dir = data_dir;
    my->_options = &options;
+
+   if( options.count("shared-file-dir") )
+      my->_shared_dir = fc::path( options.at("shared-file-dir").as<string>() );
+   else
+      my->_shared_dir = data_dir / "blockchain";
 }
 
 void application::startup()
@@ -1056,6 +1110,11 @@ std::shared_ptr<chain::database> application::chain_database() const
 {
    return my->_chain_db;
 }
+
+const fc::path& application::shared_dir() const
+{
+   return my->_shared_dir;
+}
 /*std::shared_ptr<graphene::db::object_database> application::pending_trx_database() const
 {
    return my->_pending_trx_db;
@@ -1096,11 +1155,20 @@ void application::connect_to_write_node()
    if( _remote_endpoint )
    {
       _remote_net_api.reset();
-      auto ws_ptr = _client.connect( *_remote_endpoint );
-      auto apic = std::make_shared< fc::rpc::websocket_api_connection >( *ws_ptr );
-      auto login = apic->get_remote_api< login_api >( 1 );
-      FC_ASSERT( login->login( "", "" ) );
-      _remote_net_api = login->get_api_by_name( "network_broadcast_api" )->as< network_broadcast_api >();
+      _ws_ptr = _client.connect( *_remote_endpoint );
+      _ws_apic = std::make_shared< fc::rpc::websocket_api_connection >( *_ws_ptr );
+      // forget the write node when it goes away, the next broadcast reconnects
+      fc::rpc::websocket_api_connection* apic = _ws_apic.get();
+      _ws_apic->closed.connect( [this, apic]()
+      {
+         if( _ws_apic.get() != apic )
+            return;
+         _remote_net_api.reset();
+         _remote_login.reset();
+      } );
+      _remote_login = _ws_apic->get_remote_api< login_api >( 1 );
+      FC_ASSERT( (*_remote_login)->login( "", "" ) );
+      _remote_net_api = (*_remote_login)->get_api_by_name( "network_broadcast_api" )->as< network_broadcast_api >();
    }
 }
 
@@ -253,6 +253,28 @@ dynamic_global_property_api_obj database_api_impl::get_dynamic_global_properties
    return dynamic_global_property_api_obj( _db.get( dynamic_global_property_id_type() ), _db );
 }
 
+vector< chainbase::index_statistics > database_api::get_index_statistics()const
+{
+   return my->_db.with_read_lock( [&]()
+   {
+      return my->_db.get_index_statistics();
+   });
+}
+
+chainbase::allocator_statistics database_api::get_allocator_statistics()const
+{
+   return my->_db.with_read_lock( [&]()
+   {
+      return my->_db.get_allocator_statistics();
+   });
+}
+
+vector< event_subscriber_statistics > database_api::get_event_subscriber_statistics()const
+{
+   // the subscribers only change while plugins start, no read lock to wait behind a slow block for
+   return my->_db.get_event_subscriber_statistics();
+}
+
 bobserver_schedule_api_obj database_api::get_bobserver_schedule()const
 {
    return my->_db.with_read_lock( [&]()
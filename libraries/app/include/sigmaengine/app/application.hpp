@@ -84,6 +84,11 @@ namespace sigmaengine { namespace app {
 
          graphene::net::node_ptr                    p2p_node();
          std::shared_ptr<chain::database> chain_database()const;
+
+         /**
+          * Directory of the shared memory file, plugins keep state which has to stay in step with it there.
+          */
+         const fc::path& shared_dir()const;
          //std::shared_ptr<graphene::db::object_database> pending_trx_database() const;
 
          void set_block_production(bool producing_blocks);
@@ -117,6 +117,21 @@ class database_api
 
       dapp_reward_fund_api_object      get_dapp_reward_fund() const;
 
+      /**
+       * @brief Object counts, shared memory allocated and undo stack sizes of every index, including plugin indexes
+       */
+      vector< chainbase::index_statistics > get_index_statistics()const;
+
+      /**
+       * @brief Size and free memory of the shared memory segment and, when the size class allocator is built in, the use of each size class
+       */
+      chainbase::allocator_statistics get_allocator_statistics()const;
+
+      /**
+       * @brief How far each plugin consuming applied blocks on its own thread is behind the chain
+       */
+      vector< event_subscriber_statistics > get_event_subscriber_statistics()const;
+
       //////////
       // Keys //
       //////////
@@ -294,6 +309,9 @@ FC_API(sigmaengine::app::database_api,
    (get_next_scheduled_hardfork)
 
    (get_dapp_reward_fund)
+   (get_index_statistics)
+   (get_allocator_statistics)
+   (get_event_subscriber_statistics)
 
    // Keys
    (get_key_references)
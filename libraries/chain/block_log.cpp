@@ -263,6 +263,53 @@ namespace sigmaengine { namespace chain {
       FC_LOG_AND_RETHROW()
    }
 
+   uint32_t block_log::read_raw_block_range( uint32_t first_block_num, uint32_t max_blocks, uint64_t max_bytes,
+                                             std::vector< char >& data, std::vector< uint64_t >& offsets )const
+   {
+      try
+      {
+         data.clear();
+         offsets.clear();
+
+         if( !( my->head.valid() && first_block_num > 0 && max_blocks > 0 ) )
+            return 0;
+         uint32_t head_num = protocol::block_header::num_from_id( my->head_id );
+         if( first_block_num > head_num )
+            return 0;
+
+         uint32_t last_block_num = first_block_num + std::min( max_blocks, head_num - first_block_num + 1 ) - 1;
+
+         // Block i occupies [ pos(i), pos(i+1) ) including its trailing position, the head block ends at the end of the file.
+         my->check_index_read();
+         std::vector< uint64_t > positions( last_block_num - first_block_num + 2 );
+         size_t index_count = last_block_num < head_num ? positions.size() : positions.size() - 1;
+         my->index_stream.seekg( sizeof( uint64_t ) * ( first_block_num - 1 ) );
+         my->index_stream.read( (char*)positions.data(), sizeof( uint64_t ) * index_count );
+
+         my->check_block_read();
+         if( index_count < positions.size() )
+         {
+            my->block_stream.seekg( 0, std::ios::end );
+            positions.back() = uint64_t( my->block_stream.tellg() );
+         }
+
+         size_t count = 1;
+         while( count < positions.size() - 1 && positions[ count + 1 ] - positions[0] <= max_bytes )
+            ++count;
+
+         offsets.reserve( count );
+         for( size_t i = 0; i < count; ++i )
+            offsets.push_back( positions[i] - positions[0] );
+
+         data.resize( positions[ count ] - positions[0] );
+         my->block_stream.seekg( positions[0] );
+         my->block_stream.read( data.data(), data.size() );
+
+         return count;
+      }
+      FC_LOG_AND_RETHROW()
+   }
+
    signed_block block_log::read_head()const
    {
       try
@@ -17,15 +17,14 @@ void update_bobserver_schedule4( database& db )
    active_bobservers.reserve( SIGMAENGINE_NUM_BOBSERVERS );
 
    /// Add the highest voted bobservers
-   flat_set< bobserver_id_type > selected_bp;
-   selected_bp.reserve( bo_schedule_object.max_voted_bobservers );
-
    dlog( "BP : max_voted_bobservers = ${max BP}", ( "max BP", bo_schedule_object.max_voted_bobservers ) );
 
-   const auto& bp_idx = db.get_index< bobserver_index >().indices().get< by_is_bp >();  
-   for( auto itr = bp_idx.begin(); itr != bp_idx.end(); itr++ )
-   {  // except a bo/bp in miner
-      if ( itr->is_excepted && itr->signing_key != public_key_type() ) 
+   // except a bo/bp in miner, producers first and by name
+   const auto& schedule_idx = db.get_index< bobserver_index >().indices().get< by_schedule >();
+   for( bool is_bproducer : { true, false } )
+   {
+      auto key = std::make_tuple( true, is_bproducer, true );
+      for( auto itr = schedule_idx.lower_bound( key ); itr != schedule_idx.upper_bound( key ); itr = schedule_idx.lower_bound( key ) )
       {
          db.modify( *itr, [&]( bobserver_object& o ) { 
             o.signing_key = public_key_type();
@@ -34,97 +33,70 @@ void update_bobserver_schedule4( database& db )
       }
    }
 
-   for( auto itr = bp_idx.begin();
-         itr != bp_idx.end() && selected_bp.size() < bo_schedule_object.max_voted_bobservers;
+   // no excepted bobserver has a signing key any more, so these are the producers with a key by name
+   const auto& signing_idx = db.get_index< bobserver_index >().indices().get< by_signing_name >();
+   vector< std::size_t > selected_bp_ranks;
+   selected_bp_ranks.reserve( bo_schedule_object.max_voted_bobservers );
+
+   for( auto itr = schedule_idx.lower_bound( std::make_tuple( true, true ) );
+         itr != schedule_idx.end() && itr->has_signing_key() && itr->is_bproducer
+         && selected_bp_ranks.size() < bo_schedule_object.max_voted_bobservers;
          ++itr )
    {
-      if( itr->signing_key == public_key_type() || itr->is_bproducer == false )
-         continue;
-
-      selected_bp.insert( itr->id );
+      selected_bp_ranks.push_back( signing_idx.rank( signing_idx.find( std::make_tuple( true, itr->account ) ) ) );
       active_bobservers.push_back( itr->account) ;
    }
+   std::sort( selected_bp_ranks.begin(), selected_bp_ranks.end() );
 
    dlog( "BP : BP active = ${active}", ( "active", active_bobservers ) );
 
    auto num_bp = active_bobservers.size();
 
-   flat_set< bobserver_id_type > selected_miners;
-   selected_miners.reserve( bo_schedule_object.max_miner_bobservers );
-
-   const auto& bo_idx = db.get_index<bobserver_index>().indices().get<by_name>();
+   /// Miners are the bobservers with a signing key that are not selected producers, by name
    auto now_hi = uint64_t(db.head_block_time().sec_since_epoch()) << 32;
-   uint32_t sigma_num = bo_idx.size() - selected_bp.size();
-
-   vector< account_name_type > available_bobservers;
-   available_bobservers.reserve( sigma_num );
-
-   for( auto itr = bo_idx.begin(); itr != bo_idx.end(); ++itr )
-   {
-      if( itr->signing_key != public_key_type() && selected_bp.find( itr->id ) == selected_bp.end() )
-         available_bobservers.emplace_back( itr->account );
-   }
-
-   sigma_num = available_bobservers.size();
+   uint32_t sigma_num = signing_idx.rank( signing_idx.lower_bound( std::make_tuple( false ) ) ) - num_bp;
    uint32_t max_num = std::min( (uint32_t)( SIGMAENGINE_NUM_BOBSERVERS - active_bobservers.size() ), sigma_num );
 
    dlog( "BP : max_num = ${max}, now_hi = ${hi}, sigma_num = ${num}"
       , ( "max", max_num )( "hi", now_hi )( "num", sigma_num ) );
 
-   dlog( "BP : BP available_bobservers = ${active}", ( "active", available_bobservers ) );
-
-   if ( sigma_num > 0 )
+   // Only the first max_num positions of the shuffle of all sigma_num miners are used, a position
+   // that has not been swapped yet is not in shuffled and still holds its own index
+   flat_map< uint32_t, uint32_t > shuffled;
+   shuffled.reserve( max_num );
+   auto position = [&]( uint32_t i ) -> uint32_t
    {
-      uint32_t temp_index[sigma_num];
-      for( uint32_t i = 0; i < sigma_num ; ++i )
-      {
-         temp_index[i] = i;
-      }
-
-      for( uint32_t i = 0; i < sigma_num ; ++i )
-      {
-         uint64_t k = now_hi + uint64_t(i)*2685821657736338717ULL;
-         k ^= (k >> 12);
-         k ^= (k << 25);
-         k ^= (k >> 27);
-         k *= 2685821657736338717ULL;
-
-         uint32_t jmax = sigma_num - i;
-         uint32_t j = i + k % jmax;
-
-         uint32_t temp = temp_index[i];
-         temp_index[i] = temp_index[j];
-         temp_index[j] = temp;
-      }
+      auto itr = shuffled.find( i );
+      return itr != shuffled.end() ? itr->second : i;
+   };
 
-      uint32_t index = 0;
-      while ( index < max_num )
-      {
-         int i = 0;
-         int j = temp_index[index];
-         for( auto owner_itr = available_bobservers.begin(); owner_itr!= available_bobservers.end(); ++owner_itr )
-         {
-            auto itr = bo_idx.find( *owner_itr );
-            string bo = itr->account;
-
-            if ( i == j )
-            {
-               if( selected_miners.find(itr->id) != selected_miners.end() )
-                  break;
-
-               active_bobservers.push_back( itr->account) ;
-               dlog("selected blockobserver : ${b}", ("b", bo));
-               selected_miners.insert(itr->id);
-               break;
-            }
-
-            i++;
-         }
-         index++;
-      }
+   uint32_t num_miners = 0;
+   for( uint32_t i = 0; i < max_num ; ++i )
+   {
+      uint64_t k = now_hi + uint64_t(i)*2685821657736338717ULL;
+      k ^= (k >> 12);
+      k ^= (k << 25);
+      k ^= (k >> 27);
+      k *= 2685821657736338717ULL;
+
+      uint32_t jmax = sigma_num - i;
+      uint32_t j = i + k % jmax;
+      // position i is not read again
+      uint32_t at_i = position( i );
+      std::size_t rank = position( j );
+      shuffled[ j ] = at_i;
+
+      // the rank of the miner among all bobservers with a signing key skips the selected producers
+      for( auto bp_rank : selected_bp_ranks )
+         if( bp_rank <= rank )
+            ++rank;
+
+      const auto& bo = *signing_idx.nth( rank );
+      active_bobservers.push_back( bo.account );
+      dlog("selected blockobserver : ${b}", ("b", bo.account));
+      ++num_miners;
    }
 
-   auto num_miners = selected_miners.size();
    auto num_timeshare = active_bobservers.size() - num_miners - num_bp;
    dlog( "BP : num_timeshare = ${num_time}, num_miners = ${num_miners}, num_bp = ${num_bp}"
       , ( "num_time", num_timeshare )( "num_miners", num_miners )( "num_bp", num_bp ) );
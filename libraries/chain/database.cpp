@@ -1,4 +1,5 @@
 #include <sigmaengine/protocol/sigmaengine_operations.hpp>
+#include <sigmaengine/protocol/transaction_util.hpp>
 
 #include <sigmaengine/chain/block_summary_object.hpp>
 #include <sigmaengine/chain/compound.hpp>
@@ -6,6 +7,7 @@
 #include <sigmaengine/chain/database.hpp>
 #include <sigmaengine/chain/database_exceptions.hpp>
 #include <sigmaengine/chain/db_with.hpp>
+#include <sigmaengine/chain/due_objects.hpp>
 #include <sigmaengine/chain/evaluator_registry.hpp>
 #include <sigmaengine/chain/global_property_object.hpp>
 #include <sigmaengine/chain/history_object.hpp>
@@ -24,11 +26,16 @@
 
 #include <fc/smart_ref_impl.hpp>
 #include <fc/uint128.hpp>
+#include <fc/scoped_exit.hpp>
 
 #include <fc/container/deque.hpp>
 
 #include <fc/io/fstream.hpp>
 
+#include <boost/container/small_vector.hpp>
+
+#include <algorithm>
+#include <array>
 #include <cstdint>
 #include <deque>
 #include <fstream>
@@ -68,6 +75,31 @@ namespace sigmaengine { namespace chain {
 
 using boost::container::flat_set;
 
+/**
+ * Remembers the account_authority_object of every account looked up while verifying the
+ * authority of a single transaction, so the same account is only searched for once.
+ */
+class account_authority_memo
+{
+   public:
+      account_authority_memo( const database& db ) : _db( db ) {}
+
+      const account_authority_object& get( const account_name_type& name )
+      {
+         for( const auto& item : _items )
+            if( item.first == name )
+               return *item.second;
+
+         const auto& auth = _db.get< account_authority_object, by_account >( name );
+         _items.emplace_back( name, &auth );
+         return auth;
+      }
+
+   private:
+      const database& _db;
+      boost::container::small_vector< std::pair< account_name_type, const account_authority_object* >, 8 > _items;
+};
+
 class database_impl
 {
    public:
@@ -116,6 +148,8 @@ void database::open( const fc::path& data_dir, const fc::path& shared_mem_dir, u
             undo_all();
             FC_ASSERT( revision() == head_block_num(), "Chainbase revision does not match head block num",
                ("rev", revision())("head_block", head_block_num()) );
+            set_committed_revision( head_block_num() );
+            update_recent_transaction_cache_size();
 
             // validate_invariants();
          });
@@ -128,6 +162,9 @@ void database::open( const fc::path& data_dir, const fc::path& shared_mem_dir, u
 
             _fork_db.start_block( *head_block );
          }
+
+         ilog( "Shared memory was last known to be on disk up to block ${n}", ("n", durable_revision()) );
+         start_background_flush( _background_flush_rate );
       }
 
       with_read_lock( [&]()
@@ -146,6 +183,7 @@ void database::reindex( const fc::path& data_dir, const fc::path& shared_mem_dir
       wipe( data_dir, shared_mem_dir, false );
       open( data_dir, shared_mem_dir, SIGMAENGINE_INIT_SUPPLY, shared_file_size, chainbase::database::read_write );
       _fork_db.reset();    // override effect of _fork_db.start_block() call in open()
+      stop_background_flush(); // the replay holds the write lock throughout, restarted below
 
       auto start = fc::time_point::now();
       SIGMAENGINE_ASSERT( _block_log.head(), block_log_exception, "No blocks in block log. Cannot reindex an empty chain." );
@@ -167,6 +205,10 @@ void database::reindex( const fc::path& data_dir, const fc::path& shared_mem_dir
 
       with_write_lock( [&]()
       {
+         // blocks are replayed without undo sessions and mostly create objects in key order
+         set_bulk_load( true );
+         auto end_bulk_load = fc::make_scoped_exit( [&]() { set_bulk_load( false ); _replayed_block.reset(); } );
+
          auto itr = _block_log.read_block( 0 );
          auto last_block_num = _block_log.head()->block_num();
 
@@ -176,19 +218,26 @@ void database::reindex( const fc::path& data_dir, const fc::path& shared_mem_dir
             if( cur_block_num % 100000 == 0 )
                std::cerr << "   " << double( cur_block_num * 100 ) / last_block_num << "%   " << cur_block_num << " of " << last_block_num <<
                "   (" << (get_free_memory() / (1024*1024)) << "M free)\n";
-            apply_block( itr.first, skip_flags );
+            // applied block subscribers share the block instead of copying it
+            _replayed_block = std::make_shared< const signed_block >( std::move( itr.first ) );
+            apply_block( *_replayed_block, skip_flags );
+            grow_shared_file_if_needed();
             try{
                itr = _block_log.read_block( itr.second );
             } FC_CAPTURE_AND_RETHROW( (cur_block_num) )
          }
 
-         apply_block( itr.first, skip_flags );
+         _replayed_block = std::make_shared< const signed_block >( std::move( itr.first ) );
+         apply_block( *_replayed_block, skip_flags );
          set_revision( head_block_num() );
+         set_committed_revision( head_block_num() );
       });
 
       if( _block_log.head()->block_num() )
          _fork_db.start_block( *_block_log.head() );
 
+      start_background_flush( _background_flush_rate );
+
       auto end = fc::time_point::now();
       ilog( "Done reindexing, elapsed time: ${t} sec", ("t",double((end-start).count())/1000000.0 ) );
    }
@@ -220,6 +269,7 @@ void database::close(bool rewind)
       chainbase::database::close();
 
       _block_log.close();
+      _recent_trx_cache.clear();
 
       _fork_db.reset();
    }
@@ -314,12 +364,9 @@ optional<signed_block> database::fetch_block_by_number( uint32_t block_num )cons
 
 const signed_transaction database::get_recent_transaction( const transaction_id_type& trx_id ) const
 { try {
-   auto& index = get_index<transaction_index>().indices().get<by_trx_id>();
-   auto itr = index.find(trx_id);
-   FC_ASSERT(itr != index.end());
-   signed_transaction trx;
-   fc::raw::unpack( itr->packed_trx, trx );
-   return trx;;
+   auto trx = _recent_trx_cache.fetch( trx_id );
+   FC_ASSERT( trx.valid() );
+   return *trx;
 } FC_CAPTURE_AND_RETHROW() }
 
 std::vector< block_id_type > database::get_block_ids_on_fork( block_id_type head_of_fork ) const
@@ -455,7 +502,12 @@ bool database::push_block(const signed_block& new_block, uint32_t skip)
                result = _push_block(new_block);
             }
             FC_CAPTURE_AND_RETHROW( (new_block) )
+
+            // pending transactions are popped, so no undo session refers to the current mapping
+            grow_shared_file_if_needed();
          });
+         // read only processes attached to the same shared memory file see the block from here on
+         set_committed_revision( head_block_num() );
       });
    });
 
@@ -797,6 +849,8 @@ void database::pop_block()
 
       _popped_tx.insert( _popped_tx.begin(), head_block->transactions.begin(), head_block->transactions.end() );
 
+      notify_popped_block( *head_block );
+
    }
    FC_CAPTURE_AND_RETHROW()
 }
@@ -825,6 +879,38 @@ void database::notify_pre_apply_operation( operation_notification& note )
 void database::notify_post_apply_operation( const operation_notification& note )
 {
    SIGMAENGINE_TRY_NOTIFY( post_apply_operation, note )
+
+   if( _publish_block_operations )
+   {
+      _applied_block_operations.emplace_back();
+      applied_operation_event& e = _applied_block_operations.back();
+      e.trx_id       = note.trx_id;
+      e.trx_in_block = note.trx_in_block;
+      e.op_in_trx    = note.op_in_trx;
+      e.virtual_op   = note.virtual_op;
+      e.op           = note.op;
+   }
+}
+
+const operation_object& database::get_operation_object( const operation_notification& note )
+{
+   if( !note.op_obj )
+   {
+      note.op_obj = &create< operation_object >( [&]( operation_object& obj )
+      {
+         obj.trx_id       = note.trx_id;
+         obj.block        = note.block;
+         obj.trx_in_block = note.trx_in_block;
+         obj.op_in_trx    = note.op_in_trx;
+         obj.virtual_op   = note.virtual_op;
+         obj.timestamp    = head_block_time();
+         auto size = fc::raw::pack_size( note.op );
+         obj.serialized_op.resize( size );
+         fc::datastream< char* > ds( obj.serialized_op.data(), size );
+         fc::raw::pack( ds, note.op );
+      });
+   }
+   return *note.op_obj;
 }
 
 void database::push_virtual_operation( const operation& op, bool force )
@@ -840,13 +926,64 @@ void database::push_virtual_operation( const operation& op, bool force )
 void database::notify_applied_block( const signed_block& block )
 {
    SIGMAENGINE_TRY_NOTIFY( applied_block, block )
+
+   if( _applied_block_subscribers.empty() )
+      return;
+
+   const dynamic_global_property_object& dpo = get_dynamic_global_properties();
+   auto event = std::make_shared< applied_block_event >();
+   event->block_num                   = block.block_num();
+   event->block_id                    = block.id();
+   if( _replayed_block.get() == &block )
+      event->block = _replayed_block;
+   else if( auto item = _fork_db.fetch_block( event->block_id ) )
+      event->block = std::shared_ptr< const signed_block >( item, &item->data );
+   else
+      event->block = std::make_shared< const signed_block >( block );
+   event->aslot                       = dpo.current_aslot;
+   event->last_irreversible_block_num = dpo.last_irreversible_block_num;
+   if( _publish_block_operations )
+      event->operations = std::make_shared< const vector< applied_operation_event > >( std::move( _applied_block_operations ) );
+   _applied_block_operations.clear();
+
+   std::shared_ptr< const applied_block_event > published = event;
+   for( const auto& subscriber : _applied_block_subscribers )
+      subscriber->publish( published );
+}
+
+void database::notify_popped_block( const signed_block& block )
+{
+   SIGMAENGINE_TRY_NOTIFY( popped_block, block )
 }
 
 void database::notify_pre_apply_block( const signed_block& block )
 {
+   // operations of pending transactions or of a block that failed to apply are not published
+   _applied_block_operations.clear();
+
    SIGMAENGINE_TRY_NOTIFY( pre_apply_block, block )
 }
 
+std::shared_ptr< applied_block_subscriber > database::subscribe_applied_blocks( const std::string& name,
+   applied_block_subscriber::handler_type handler, bool with_operations, uint32_t capacity )
+{ try {
+   FC_ASSERT( capacity > 0 );
+   auto subscriber = std::make_shared< applied_block_subscriber >( name, capacity, std::move( handler ) );
+   _applied_block_subscribers.push_back( subscriber );
+   _publish_block_operations |= with_operations;
+   ilog( "${n} subscribed to applied blocks${o}", ("n", name)("o", with_operations ? " with operations" : "") );
+   return subscriber;
+} FC_CAPTURE_AND_RETHROW( (name)(with_operations)(capacity) ) }
+
+vector< event_subscriber_statistics > database::get_event_subscriber_statistics()const
+{
+   vector< event_subscriber_statistics > result;
+   result.reserve( _applied_block_subscribers.size() );
+   for( const auto& subscriber : _applied_block_subscribers )
+      result.push_back( subscriber->get_statistics() );
+   return result;
+}
+
 void database::notify_on_pending_transaction( const signed_transaction& tx )
 {
    SIGMAENGINE_TRY_NOTIFY( on_pending_transaction, tx )
@@ -994,131 +1131,100 @@ void database::process_funds()
 
 void database::process_savings_withdraws()
 {
-   const auto& idx = get_index< savings_withdraw_index >().indices().get< by_complete_from_rid >();
-   auto itr = idx.begin();
-   while( itr != idx.end() ) {
-      
-      if( itr->complete > head_block_time() )
-         break;
+   const auto now = head_block_time();
+   process_due_objects< savings_withdraw_index, by_complete_from_rid >( *this,
+      [&]( const savings_withdraw_object& w ) { return w.complete <= now; },
+      [&]( const savings_withdraw_object& w )
+   {
+      const auto& to = get_account( w.to );
 
-      if ( itr->split_pay_order == itr->split_pay_month ) {
+      if ( w.split_pay_order == w.split_pay_month ) {
 
-         asset  savings_balance = get_savings_balance(get_account( itr->to ), itr->amount.symbol);
-         FC_ASSERT(savings_balance >= itr->amount);
+         asset  savings_balance = get_savings_balance( to, w.amount.symbol );
+         FC_ASSERT(savings_balance >= w.amount);
 
-         adjust_balance( get_account( itr->to ), itr->amount );
-         adjust_savings_balance(get_account( itr->to ), -itr->amount);
+         adjust_balance( to, w.amount );
+         adjust_savings_balance( to, -w.amount );
 
-         push_virtual_operation( fill_transfer_savings_operation( itr->from, itr->to, itr->amount, itr->total_amount, itr->split_pay_order, itr->split_pay_month, itr->request_id, to_string(itr->memo) ) );
+         push_virtual_operation( fill_transfer_savings_operation( w.from, w.to, w.amount, w.total_amount, w.split_pay_order, w.split_pay_month, w.request_id, to_string(w.memo) ) );
 
-         remove( *itr );
-         itr = idx.begin();
+         remove( w );
 
       } else {
-         
-         account_name_type from              = itr->from;
-         account_name_type to                = itr->to;
-         shared_string     memo              = itr->memo;
-         uint32_t          request_id        = itr->request_id;
-         asset             amount            = itr->amount;
-         asset             total_amount      = itr->total_amount;
-         uint8_t           split_pay_order   = itr->split_pay_order;
-         uint8_t           split_pay_month   = itr->split_pay_month;
-         time_point_sec    complete          = itr->complete;
-
-         asset             monthly_amount    = itr->total_amount;
-         asset             savings_balance   = get_savings_balance(get_account( to ), monthly_amount.symbol);
-
-         monthly_amount.amount /= split_pay_month;
+
+         asset             monthly_amount    = w.total_amount;
+         asset             savings_balance   = get_savings_balance( to, monthly_amount.symbol );
+
+         monthly_amount.amount /= w.split_pay_month;
          FC_ASSERT(savings_balance >= monthly_amount);
 
-         adjust_balance( get_account( to ), monthly_amount );
-         adjust_savings_balance(get_account( to ), -monthly_amount);
-
-         push_virtual_operation( fill_transfer_savings_operation( from, to, monthly_amount, total_amount, split_pay_order, split_pay_month, request_id, to_string(memo) ) );
-         
-         remove( *itr );
-         itr = idx.begin();
-
-         create<savings_withdraw_object>( [&]( savings_withdraw_object& s ) {
-            s.from            = from;
-            s.to              = to;           
-            s.amount          = amount - monthly_amount;
-            s.total_amount    = total_amount;
-            s.split_pay_month = split_pay_month;
-            s.split_pay_order = split_pay_order + 1;
-#ifndef IS_LOW_MEM
-            s.memo            = memo;
-#endif
-            s.request_id      = request_id;
-            s.complete        = complete + SIGMAENGINE_TRANSFER_SAVINGS_CYCLE;
+         adjust_balance( to, monthly_amount );
+         adjust_savings_balance( to, -monthly_amount );
+
+         push_virtual_operation( fill_transfer_savings_operation( w.from, w.to, monthly_amount, w.total_amount, w.split_pay_order, w.split_pay_month, w.request_id, to_string(w.memo) ) );
+
+         // the next payment of the same request, the memo stays where it is
+         modify( w, [&]( savings_withdraw_object& s ) {
+            s.amount          -= monthly_amount;
+            s.split_pay_order += 1;
+            s.complete        += SIGMAENGINE_TRANSFER_SAVINGS_CYCLE;
          });
       }
-   }
+      return true;
+   });
 }
 
 void database::process_fund_withdraws()
 {
-   const auto& idx = get_index< fund_withdraw_index >().indices().get< by_complete_from >();
-   auto itr = idx.begin();
-   while( itr != idx.end() ) {
-      
-      if( itr->complete > head_block_time() )
-         break;
-
-      string fund_name = to_string(itr->fund_name);
+   const auto now = head_block_time();
+   process_due_objects< fund_withdraw_index, by_complete_from >( *this,
+      [&]( const fund_withdraw_object& w ) { return w.complete <= now; },
+      [&]( const fund_withdraw_object& w )
+   {
+      string fund_name = to_string(w.fund_name);
       asset  fund_balance = get_common_fund(fund_name).fund_balance;
-      if(fund_balance < itr->amount){
-         ilog( "process_fund_withdraws : lack of fund balance. fund_balance/required amount = ${balance}/${amount}", ("balance", fund_balance)("amount", itr->amount) );
-         return;
+      if(fund_balance < w.amount){
+         ilog( "process_fund_withdraws : lack of fund balance. fund_balance/required amount = ${balance}/${amount}", ("balance", fund_balance)("amount", w.amount) );
+         return false;
       }
 
-      adjust_balance( get_account( itr->from ), itr->amount );
-      adjust_fund_balance(fund_name, -itr->amount);
-      adjust_fund_withdraw_balance(fund_name, -itr->amount);
-      push_virtual_operation( fill_staking_fund_operation( itr->from, fund_name, itr->amount, itr->request_id, to_string(itr->memo) ) );
+      adjust_balance( get_account( w.from ), w.amount );
+      adjust_fund_balance(fund_name, -w.amount);
+      adjust_fund_withdraw_balance(fund_name, -w.amount);
+      push_virtual_operation( fill_staking_fund_operation( w.from, fund_name, w.amount, w.request_id, to_string(w.memo) ) );
 
-      remove( *itr );
-      itr = idx.begin();
-   }
+      remove( w );
+      return true;
+   });
 }
 
 void database::account_recovery_processing()
 {
-   // Clear expired recovery requests
-   const auto& rec_req_idx = get_index< account_recovery_request_index >().indices().get< by_expiration >();
-   auto rec_req = rec_req_idx.begin();
+   const auto now = head_block_time();
 
-   while( rec_req != rec_req_idx.end() && rec_req->expires <= head_block_time() )
-   {
-      remove( *rec_req );
-      rec_req = rec_req_idx.begin();
-   }
+   // Clear expired recovery requests
+   process_due_objects< account_recovery_request_index, by_expiration >( *this,
+      [&]( const account_recovery_request_object& r ) { return r.expires <= now; },
+      [&]( const account_recovery_request_object& r ) { remove( r ); return true; } );
 
    // Clear invalid historical authorities
-   const auto& hist_idx = get_index< owner_authority_history_index >().indices(); //by id
-   auto hist = hist_idx.begin();
-
-   while( hist != hist_idx.end() && time_point_sec( hist->last_valid_time + SIGMAENGINE_OWNER_AUTH_RECOVERY_PERIOD ) < head_block_time() )
-   {
-      remove( *hist );
-      hist = hist_idx.begin();
-   }
+   process_due_objects< owner_authority_history_index, by_id >( *this,
+      [&]( const owner_authority_history_object& h ) { return time_point_sec( h.last_valid_time + SIGMAENGINE_OWNER_AUTH_RECOVERY_PERIOD ) < now; },
+      [&]( const owner_authority_history_object& h ) { remove( h ); return true; } );
 
    // Apply effective recovery_account changes
-   const auto& change_req_idx = get_index< change_recovery_account_request_index >().indices().get< by_effective_date >();
-   auto change_req = change_req_idx.begin();
-
-   while( change_req != change_req_idx.end() && change_req->effective_on <= head_block_time() )
+   process_due_objects< change_recovery_account_request_index, by_effective_date >( *this,
+      [&]( const change_recovery_account_request_object& r ) { return r.effective_on <= now; },
+      [&]( const change_recovery_account_request_object& r )
    {
-      modify( get_account( change_req->account_to_recover ), [&]( account_object& a )
+      modify( get_account( r.account_to_recover ), [&]( account_object& a )
       {
-         a.recovery_account = change_req->recovery_account;
+         a.recovery_account = r.recovery_account;
       });
 
-      remove( *change_req );
-      change_req = change_req_idx.begin();
-   }
+      remove( r );
+      return true;
+   });
 }
 
 time_point_sec database::head_block_time()const
@@ -1205,6 +1311,7 @@ void database::initialize_indexes()
    add_core_index< bobserver_vote_index                    >(*this);
    add_core_index< operation_index                         >(*this);
    add_core_index< account_history_index                   >(*this);
+   add_core_index< account_history_sequence_index          >(*this);
    add_core_index< hardfork_property_index                 >(*this);
    add_core_index< owner_authority_history_index           >(*this);
    add_core_index< account_recovery_request_index          >(*this);
@@ -1446,6 +1553,44 @@ void database::set_flush_interval( uint32_t flush_blocks )
    _next_flush_block = 0;
 }
 
+void database::set_background_flush_rate( uint64_t bytes_per_second )
+{
+   _background_flush_rate = bytes_per_second;
+}
+
+void database::set_recent_transaction_cache_limit( size_t max_transactions )
+{
+   _recent_trx_cache_limit = max_transactions;
+}
+
+void database::set_shared_file_growth( uint64_t threshold, uint64_t increment )
+{
+   _shared_file_grow_threshold = threshold;
+   _shared_file_grow_size = increment;
+}
+
+void database::grow_shared_file_if_needed()
+{
+   if( _shared_file_grow_threshold == 0 || get_free_memory() >= _shared_file_grow_threshold )
+      return;
+
+   FC_ASSERT( !_pending_tx_session.valid(), "Cannot grow shared memory while pending transactions are applied" );
+
+   uint64_t increment = std::max( _shared_file_grow_size, _shared_file_grow_threshold );
+   auto start = fc::time_point::now();
+   grow( increment );
+   _last_free_gb_printed = 0;
+
+   ilog( "Grew shared memory file by ${i}M at block ${b} in ${t} ms, ${f}M free",
+         ("i", increment / (1024*1024))("b", head_block_num())("t", (fc::time_point::now() - start).count() / 1000)
+         ("f", get_free_memory() / (1024*1024)) );
+}
+
+void database::set_index_statistics_interval( uint32_t blocks )
+{
+   _index_statistics_blocks = blocks;
+}
+
 //////////////////// private methods ////////////////////
 
 void database::apply_block( const signed_block& next_block, uint32_t skip )
@@ -1490,7 +1635,7 @@ void database::apply_block( const signed_block& next_block, uint32_t skip )
 
    //fc::time_point end_time = fc::time_point::now();
    //fc::microseconds dt = end_time - begin_time;
-   if( _flush_blocks != 0 )
+   if( _flush_blocks != 0 && _background_flush_rate == 0 )
    {
       if( _next_flush_block == 0 )
       {
@@ -1519,6 +1664,9 @@ void database::apply_block( const signed_block& next_block, uint32_t skip )
 
    show_free_memory( false );
 
+   if( _index_statistics_blocks != 0 && block_num % _index_statistics_blocks == 0 )
+      show_index_statistics();
+
 } FC_CAPTURE_AND_RETHROW( (next_block) ) }
 
 void database::show_free_memory( bool force )
@@ -1526,7 +1674,8 @@ void database::show_free_memory( bool force )
    uint32_t free_gb = uint32_t( get_free_memory() / (1024*1024*1024) );
    if( force || (free_gb < _last_free_gb_printed) || (free_gb > _last_free_gb_printed+1) )
    {
-      ilog( "Free memory is now ${n}G", ("n", free_gb) );
+      auto faults = get_page_faults();
+      ilog( "Free memory is now ${n}G, ${minor} minor and ${major} major page faults so far", ("n", free_gb)("minor", faults.first)("major", faults.second) );
       _last_free_gb_printed = free_gb;
    }
 
@@ -1539,6 +1688,52 @@ void database::show_free_memory( bool force )
    }
 }
 
+void database::show_index_statistics()
+{
+   auto stats = get_index_statistics();
+   std::sort( stats.begin(), stats.end(), []( const chainbase::index_statistics& a, const chainbase::index_statistics& b )
+   {
+      return a.allocated_bytes > b.allocated_bytes;
+   });
+
+   int64_t  allocated = 0;
+   uint64_t objects = 0;
+   uint64_t undo = 0;
+   for( const auto& s : stats )
+   {
+      allocated += s.allocated_bytes;
+      objects += s.object_count;
+      undo += s.undo_bytes;
+   }
+
+   ilog( "${n} indexes hold ${o} objects in ${a}M, undo stacks about ${u}M, ${f}M free",
+         ("n", stats.size())("o", objects)("a", allocated / (1024*1024))("u", undo / (1024*1024))("f", get_free_memory() / (1024*1024)) );
+
+   for( size_t i = 0; i < stats.size() && i < 10; ++i )
+   {
+      const auto& s = stats[i];
+      ilog( "   ${t}: ${o} objects, ${a}K allocated (${x} objects untracked), ${s} undo states with ${old} modified, ${r} removed and ${new} new objects",
+            ("t", s.type_name)("o", s.object_count)("a", s.allocated_bytes / 1024)("x", s.untracked_objects)
+            ("s", s.undo_states)("old", s.undo_old_values)("r", s.undo_removed_values)("new", s.undo_new_ids) );
+   }
+
+   auto allocator = get_allocator_statistics();
+   if( !allocator.size_classes )
+      return;
+
+   uint64_t reserved = 0;
+   uint64_t used = 0;
+   uint64_t requested = 0;
+   for( const auto& c : allocator.classes )
+   {
+      reserved += c.slabs * chainbase::size_class_pools::slab_size;
+      used += c.used_blocks * c.size;
+      requested += c.requested_bytes;
+   }
+   ilog( "Size classes hold ${r}M in slabs, ${u}M in used blocks of which ${w}K rounding, the rest free or not yet carved",
+         ("r", reserved / (1024*1024))("u", used / (1024*1024))("w", (used - requested) / 1024) );
+}
+
 void database::_apply_block( const signed_block& next_block )
 { try {
    notify_pre_apply_block( next_block );
@@ -1691,7 +1886,7 @@ void database::_apply_transaction(const signed_transaction& trx)
 
    auto& trx_idx = get_index<transaction_index>();
    const chain_id_type& chain_id = SIGMAENGINE_CHAIN_ID;
-   auto trx_id = trx.id();
+   auto trx_id = _current_trx_id;
    // idump((trx_id)(skip&skip_transaction_dupe_check));
    FC_ASSERT( (skip & skip_transaction_dupe_check) ||
               trx_idx.indices().get<by_trx_id>().find(trx_id) == trx_idx.indices().get<by_trx_id>().end(),
@@ -1699,13 +1894,14 @@ void database::_apply_transaction(const signed_transaction& trx)
 
    if( !(skip & (skip_transaction_signatures | skip_authority_check) ) )
    {
-      auto get_active  = [&]( const string& name ) { return authority( get< account_authority_object, by_account >( name ).active ); };
-      auto get_owner   = [&]( const string& name ) { return authority( get< account_authority_object, by_account >( name ).owner );  };
-      auto get_posting = [&]( const string& name ) { return authority( get< account_authority_object, by_account >( name ).posting );  };
+      account_authority_memo auths( *this );
+      auto get_active  = [&]( const account_name_type& name ) -> const shared_authority& { return auths.get( name ).active; };
+      auto get_owner   = [&]( const account_name_type& name ) -> const shared_authority& { return auths.get( name ).owner; };
+      auto get_posting = [&]( const account_name_type& name ) -> const shared_authority& { return auths.get( name ).posting; };
 
       try
       {
-         trx.verify_authority( chain_id, get_active, get_owner, get_posting, SIGMAENGINE_MAX_SIG_CHECK_DEPTH );
+         protocol::verify_authority( trx.operations, trx.get_signature_keys( chain_id ), get_active, get_owner, get_posting, SIGMAENGINE_MAX_SIG_CHECK_DEPTH );
       }
       catch( protocol::tx_missing_active_auth& e )
       {
@@ -1741,7 +1937,6 @@ void database::_apply_transaction(const signed_transaction& trx)
       create<transaction_object>([&](transaction_object& transaction) {
          transaction.trx_id = trx_id;
          transaction.expiration = trx.expiration;
-         fc::raw::pack( transaction.packed_trx, trx );
       });
    }
 
@@ -1758,6 +1953,10 @@ void database::_apply_transaction(const signed_transaction& trx)
    }
    _current_trx_id = transaction_id_type();
 
+   // Keep the body around so peers can fetch it, the dedup index only holds the id.
+   if( !(skip & skip_transaction_dupe_check) )
+      _recent_trx_cache.insert( trx_id, trx );
+
 } FC_CAPTURE_AND_RETHROW( (trx) ) }
 
 void database::apply_operation(const operation& op)
@@ -1882,10 +2081,11 @@ void database::update_last_irreversible_block()
    {
       const bobserver_schedule_object& wso = get_bobserver_schedule_object();
 
-      vector< const bobserver_object* > wit_objs;
-      wit_objs.reserve( wso.num_scheduled_bobservers );
-      for( int i = 0; i < wso.num_scheduled_bobservers; i++ )
-         wit_objs.push_back( &get_bobserver( wso.current_shuffled_bobservers[i] ) );
+      // at most SIGMAENGINE_NUM_BOBSERVERS values, selected in place without allocating every block
+      std::array< uint64_t, SIGMAENGINE_NUM_BOBSERVERS > confirmed;
+      size_t num_confirmed = wso.num_scheduled_bobservers;
+      for( size_t i = 0; i < num_confirmed; i++ )
+         confirmed[i] = get_bobserver( wso.current_shuffled_bobservers[i] ).last_confirmed_block_num;
 
       static_assert( SIGMAENGINE_IRREVERSIBLE_THRESHOLD > 0, "irreversible threshold must be nonzero" );
 
@@ -1893,15 +2093,11 @@ void database::update_last_irreversible_block()
       // 1 1 1 1 1 1 1 2 2 2 -> 1
       // 3 3 3 3 3 3 3 3 3 3 -> 3
 
-      size_t offset = ((SIGMAENGINE_100_PERCENT - SIGMAENGINE_IRREVERSIBLE_THRESHOLD) * wit_objs.size() / SIGMAENGINE_100_PERCENT);
+      size_t offset = ((SIGMAENGINE_100_PERCENT - SIGMAENGINE_IRREVERSIBLE_THRESHOLD) * num_confirmed / SIGMAENGINE_100_PERCENT);
 
-      std::nth_element( wit_objs.begin(), wit_objs.begin() + offset, wit_objs.end(),
-         []( const bobserver_object* a, const bobserver_object* b )
-         {
-            return a->last_confirmed_block_num < b->last_confirmed_block_num;
-         } );
+      std::nth_element( confirmed.begin(), confirmed.begin() + offset, confirmed.begin() + num_confirmed );
 
-      uint32_t new_last_irreversible_block_num = wit_objs[offset]->last_confirmed_block_num;
+      uint32_t new_last_irreversible_block_num = confirmed[offset];
 
       if( new_last_irreversible_block_num > dpo.last_irreversible_block_num )
       {
@@ -1944,10 +2140,21 @@ void database::clear_expired_transactions()
 {
    //Look for expired transactions in the deduplication list, and remove them.
    //Transactions must have expired by at least two forking windows in order to be removed.
-   auto& transaction_idx = get_index< transaction_index >();
-   const auto& dedupe_index = transaction_idx.indices().get< by_expiration >();
-   while( ( !dedupe_index.empty() ) && ( head_block_time() > dedupe_index.begin()->expiration ) )
-      remove( *dedupe_index.begin() );
+   const auto now = head_block_time();
+   process_due_objects< transaction_index, by_expiration >( *this,
+      [&]( const transaction_object& t ) { return now > t.expiration; },
+      [&]( const transaction_object& t ) { remove( t ); return true; } );
+
+   _recent_trx_cache.clear_expired( head_block_time() );
+   update_recent_transaction_cache_size();
+}
+
+void database::update_recent_transaction_cache_size()
+{
+   size_t max_size = std::min( recent_transaction_cache::max_transactions( get_dynamic_global_properties().maximum_block_size ),
+                               _recent_trx_cache_limit );
+   if( max_size != _recent_trx_cache.max_size() )
+      _recent_trx_cache.set_max_size( max_size );
 }
 
 void database::adjust_balance( const account_object& a, const asset& delta )
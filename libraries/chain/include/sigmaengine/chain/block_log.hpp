@@ -51,6 +51,15 @@ namespace sigmaengine { namespace chain {
           * Return offset of block in file, or block_log::npos if it does not exist.
           */
          uint64_t get_block_pos( uint32_t block_num ) const;
+
+         /**
+          * Copies the unmodified log bytes of up to max_blocks blocks starting at first_block_num into data,
+          * stopping before max_bytes is exceeded (at least one block is always copied). Each block is followed
+          * by its 8 byte position as in the log file. offsets receives the position of every block within data.
+          * Returns the number of blocks copied, 0 if first_block_num is not in the log.
+          */
+         uint32_t read_raw_block_range( uint32_t first_block_num, uint32_t max_blocks, uint64_t max_bytes,
+                                        std::vector< char >& data, std::vector< uint64_t >& offsets )const;
          signed_block read_head()const;
          const optional< signed_block >& head()const;
 
@@ -6,6 +6,8 @@
 #include <sigmaengine/chain/sigmaengine_object_types.hpp>
 
 #include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/mem_fun.hpp>
+#include <boost/multi_index/ranked_index.hpp>
 
 namespace sigmaengine { namespace chain {
 
@@ -67,6 +69,8 @@ namespace sigmaengine { namespace chain {
          bool              is_excepted = false;
 
          account_name_type bp_owner;
+
+         bool has_signing_key()const { return signing_key != public_key_type(); }
    };
 
    class bobserver_vote_object : public object< bobserver_vote_object_type, bobserver_vote_object >
@@ -114,6 +118,8 @@ namespace sigmaengine { namespace chain {
    struct by_name;
    struct by_is_bp;
    struct by_bp_owner;
+   struct by_schedule;
+   struct by_signing_name;
    
    /**
     * @ingroup object_index
@@ -142,6 +148,24 @@ namespace sigmaengine { namespace chain {
                member< bobserver_object, account_name_type, &bobserver_object::bp_owner >, 
                member< bobserver_object, bobserver_id_type, &bobserver_object::id > 
             >
+         >,
+         /// bobservers with a signing key first, within them producers and then excepted ones first, by name
+         ordered_unique< tag< by_schedule >,
+            composite_key< bobserver_object,
+               const_mem_fun< bobserver_object, bool, &bobserver_object::has_signing_key >,
+               member< bobserver_object, bool, &bobserver_object::is_bproducer >,
+               member< bobserver_object, bool, &bobserver_object::is_excepted >,
+               member< bobserver_object, account_name_type, &bobserver_object::account >
+            >,
+            composite_key_compare< std::greater< bool >, std::greater< bool >, std::greater< bool >, std::less< account_name_type > >
+         >,
+         /// bobservers with a signing key by name, ranked to pick miners by position
+         ranked_unique< tag< by_signing_name >,
+            composite_key< bobserver_object,
+               const_mem_fun< bobserver_object, bool, &bobserver_object::has_signing_key >,
+               member< bobserver_object, account_name_type, &bobserver_object::account >
+            >,
+            composite_key_compare< std::greater< bool >, std::less< account_name_type > >
          >
       >,
       allocator< bobserver_object >
@@ -7,7 +7,9 @@
 #include <sigmaengine/chain/node_property_object.hpp>
 #include <sigmaengine/chain/fork_database.hpp>
 #include <sigmaengine/chain/block_log.hpp>
+#include <sigmaengine/chain/event_bus.hpp>
 #include <sigmaengine/chain/operation_notification.hpp>
+#include <sigmaengine/chain/recent_transaction_cache.hpp>
 
 #include <sigmaengine/protocol/protocol.hpp>
 #include <sigmaengine/protocol/hardfork.hpp>
@@ -111,6 +113,8 @@ namespace sigmaengine { namespace chain {
          optional<signed_block>     fetch_block_by_number( uint32_t num )const;
          const signed_transaction   get_recent_transaction( const transaction_id_type& trx_id )const;
          std::vector<block_id_type> get_block_ids_on_fork(block_id_type head_of_fork) const;
+         /// irreversible blocks only, reversible blocks are in the fork database
+         const block_log&           get_block_log()const { return _block_log; }
 
          chain_id_type             get_chain_id()const;
 
@@ -175,9 +179,13 @@ namespace sigmaengine { namespace chain {
           */
          void notify_pre_apply_operation( operation_notification& note );
          void notify_post_apply_operation( const operation_notification& note );
+
+         /// the operation_object of the notified operation, created the first time it is asked for
+         const operation_object& get_operation_object( const operation_notification& note );
          void push_virtual_operation( const operation& op, bool force = false ); // vops are not needed for low mem. Force will push them on low mem.
          void notify_pre_apply_block( const signed_block& block );
          void notify_applied_block( const signed_block& block );
+         void notify_popped_block( const signed_block& block );
          void notify_on_pending_transaction( const signed_transaction& tx );
          void notify_on_pre_apply_transaction( const signed_transaction& tx );
          void notify_on_applied_transaction( const signed_transaction& tx );
@@ -201,6 +209,12 @@ namespace sigmaengine { namespace chain {
           */
          fc::signal<void(const signed_block&)>           applied_block;
 
+         /**
+          *  This signal is emitted after the head block has been popped and its changes undone,
+          *  e.g. by a fork switch before the blocks of the other fork are applied.
+          */
+         fc::signal<void(const signed_block&)>           popped_block;
+
          /**
           * This signal is emitted any time a new transaction is added to the pending
           * block state.
@@ -224,6 +238,21 @@ namespace sigmaengine { namespace chain {
           */
          fc::signal< void( const uint32_t& ) > on_apply_hardfork;
 
+         /**
+          *  Hands every applied block to handler on a thread of the subscriber's own, for observers that
+          *  do not change the chain state and should not make block application slower.  The handler
+          *  runs while later blocks are applied and only gets what is in the event, it must not lock
+          *  or read the database: when its ring is full the block is published with the write lock
+          *  held until the handler catches up.  Handlers that read or change the state or that
+          *  evaluators depend on connect to the signals above.
+          *
+          *  Subscribe from plugin_initialize() or plugin_startup(), stop the subscriber in plugin_shutdown().
+          */
+         std::shared_ptr< applied_block_subscriber > subscribe_applied_blocks( const std::string& name,
+            applied_block_subscriber::handler_type handler, bool with_operations = false, uint32_t capacity = 1024 );
+
+         vector< event_subscriber_statistics > get_event_subscriber_statistics()const;
+
          /**
           *  Emitted After a block has been applied and committed.  The callback
           *  should not yield and should execute quickly.
@@ -337,7 +366,31 @@ namespace sigmaengine { namespace chain {
          const std::string& get_json_schema() const;
 
          void set_flush_interval( uint32_t flush_blocks );
+
+         /**
+          * Write back shared memory from a background thread scanning at most bytes_per_second
+          * instead of flushing all of it on the apply thread every flush interval.  0 disables it.
+          * Takes effect on open.
+          */
+         void set_background_flush_rate( uint64_t bytes_per_second );
+
+         /**
+          * Keep at most max_transactions recently seen transactions in memory to serve peers.
+          * Takes effect on open.
+          */
+         void set_recent_transaction_cache_limit( size_t max_transactions );
+
+         /**
+          * Grow the shared memory file by increment bytes whenever less than threshold bytes are free
+          * after a block.  A threshold of 0 disables it.
+          */
+         void set_shared_file_growth( uint64_t threshold, uint64_t increment );
          void show_free_memory( bool force );
+
+         /// log show_index_statistics() every this many blocks, 0 disables it
+         void set_index_statistics_interval( uint32_t blocks );
+         /// logs the indexes which allocated the most shared memory and the size of their undo stacks
+         void show_index_statistics();
          // bool skip_transaction_delta_check = true;
 
          void process_funds();
@@ -378,6 +431,13 @@ namespace sigmaengine { namespace chain {
          void update_signing_bobserver(const bobserver_object& signing_bobserver, const signed_block& new_block);
          void update_last_irreversible_block();
          void clear_expired_transactions();
+         /**
+          * Sizes the recent transaction cache to the number of transactions that blocks of the
+          * current maximum size can hold within the expiration window, at most the configured limit.
+          */
+         void update_recent_transaction_cache_size();
+         /// called between blocks with no undo session open, see set_shared_file_growth
+         void grow_shared_file_if_needed();
          void process_header_extensions( const signed_block& next_block );
 
          void init_hardforks();
@@ -389,6 +449,7 @@ namespace sigmaengine { namespace chain {
          std::unique_ptr< database_impl > _my;
 
          vector< signed_transaction >  _pending_tx;
+         mutable recent_transaction_cache _recent_trx_cache;
          fork_database                 _fork_db;
          fc::time_point_sec            _hardfork_times[ SIGMAENGINE_NUM_HARDFORKS + 1 ];
          protocol::hardfork_version    _hardfork_versions[ SIGMAENGINE_NUM_HARDFORKS + 1 ];
@@ -401,6 +462,11 @@ namespace sigmaengine { namespace chain {
 
          fc::signal< void() >          _plugin_index_signal;
 
+         vector< std::shared_ptr< applied_block_subscriber > >   _applied_block_subscribers;
+         bool                                                    _publish_block_operations = false;
+         vector< applied_operation_event >                       _applied_block_operations; ///< of the block being applied
+         std::shared_ptr< const signed_block >                   _replayed_block;  ///< by reindex, shared with applied block subscribers
+
          transaction_id_type           _current_trx_id;
          uint32_t                      _current_block_num    = 0;
          uint16_t                      _current_trx_in_block = 0;
@@ -413,8 +479,13 @@ namespace sigmaengine { namespace chain {
 
          uint32_t                      _flush_blocks = 0;
          uint32_t                      _next_flush_block = 0;
+         uint64_t                      _background_flush_rate = 0;
+         size_t                        _recent_trx_cache_limit = 200000;
+         uint64_t                      _shared_file_grow_threshold = 0;
+         uint64_t                      _shared_file_grow_size = 0;
 
          uint32_t                      _last_free_gb_printed = 0;
+         uint32_t                      _index_statistics_blocks = 0;
 
          flat_map< std::string, std::shared_ptr< custom_operation_interpreter > >   _custom_operation_interpreters;
          std::string                   _json_schema;
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <sigmaengine/chain/database.hpp>
+
+namespace sigmaengine { namespace chain {
+
+/**
+ * Hands the objects of an index ordered by the time they are due to action, earliest first, for
+ * as long as is_due( object ) holds.  action either removes the object or modifies it to be due
+ * later, then the next object is the first one of the index again, which is found without a
+ * search.  action returns false to leave the object and all later ones for a later block.
+ *
+ * The objects are chain state, so what action does is undone with the block like any other
+ * change.  Callers keep their place in the block, the order in which the due objects of
+ * different indexes are processed is part of consensus.
+ */
+template< typename IndexType, typename Tag, typename IsDue, typename Action >
+void process_due_objects( database& db, IsDue&& is_due, Action&& action )
+{
+   const auto& idx = db.get_index< IndexType >().indices().template get< Tag >();
+   for( auto itr = idx.begin(); itr != idx.end() && is_due( *itr ); itr = idx.begin() )
+   {
+      if( !action( *itr ) )
+         break;
+   }
+}
+
+} } // sigmaengine::chain
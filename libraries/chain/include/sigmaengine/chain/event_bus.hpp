@@ -0,0 +1,282 @@
+#pragma once
+#include <sigmaengine/protocol/block.hpp>
+#include <sigmaengine/protocol/operations.hpp>
+
+#include <fc/log/logger.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/time.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sigmaengine { namespace chain {
+
+   using sigmaengine::protocol::block_id_type;
+   using sigmaengine::protocol::operation;
+   using sigmaengine::protocol::signed_block;
+   using sigmaengine::protocol::transaction_id_type;
+
+   /**
+    *  Fixed size ring of T for exactly one thread pushing and one thread popping, neither takes a lock.
+    *  The capacity is rounded up to a power of two.
+    */
+   template< typename T >
+   class spsc_ring
+   {
+      public:
+         explicit spsc_ring( size_t capacity )
+         {
+            size_t size = 2;
+            while( size < capacity )
+               size <<= 1;
+            _items.resize( size );
+            _mask = size - 1;
+         }
+
+         size_t capacity()const { return _items.size(); }
+
+         size_t size()const
+         {
+            return _tail.load( std::memory_order_acquire ) - _head.load( std::memory_order_acquire );
+         }
+
+         bool empty()const { return size() == 0; }
+
+         /// producer side, false if the ring is full
+         bool push( T&& item )
+         {
+            size_t tail = _tail.load( std::memory_order_relaxed );
+            if( tail - _head.load( std::memory_order_acquire ) == _items.size() )
+               return false;
+            _items[ tail & _mask ] = std::move( item );
+            _tail.store( tail + 1, std::memory_order_release );
+            return true;
+         }
+
+         /// consumer side, false if the ring is empty
+         bool pop( T& item )
+         {
+            size_t head = _head.load( std::memory_order_relaxed );
+            if( head == _tail.load( std::memory_order_acquire ) )
+               return false;
+            item = std::move( _items[ head & _mask ] );
+            _items[ head & _mask ] = T();
+            _head.store( head + 1, std::memory_order_release );
+            return true;
+         }
+
+      private:
+         std::vector< T >                 _items;
+         size_t                           _mask = 0;
+         alignas( 64 ) std::atomic< size_t > _head{ 0 };   ///< next item to pop, written by the consumer
+         alignas( 64 ) std::atomic< size_t > _tail{ 0 };   ///< next slot to push to, written by the producer
+   };
+
+   /// How far an asynchronous subscriber is behind the events published to it
+   struct event_subscriber_statistics
+   {
+      std::string    name;
+      uint32_t       capacity = 0;
+      uint64_t       published = 0;
+      uint64_t       consumed = 0;
+      uint32_t       pending = 0;          ///< events published and not consumed yet
+      uint32_t       max_pending = 0;
+      uint64_t       producer_waits = 0;   ///< times the publisher found the ring full and waited for the subscriber
+      uint32_t       last_block_num = 0;   ///< of the last event consumed
+      int64_t        last_lag_us = 0;      ///< from publishing the last event consumed until its handler returned
+      int64_t        max_lag_us = 0;
+   };
+
+   /**
+    *  Hands events of type Event from the thread publishing them to handler on a thread of its own,
+    *  through a spsc_ring.  Publishing never drops an event, when the ring is full the publisher
+    *  waits for the subscriber, which shows in producer_waits.  The handler must not wait for
+    *  anything the publisher may hold while it waits.  Event needs a block_num member for the
+    *  statistics.
+    */
+   template< typename Event >
+   class async_event_subscriber
+   {
+      public:
+         typedef std::function< void( const Event& ) > handler_type;
+
+         async_event_subscriber( const std::string& name, uint32_t capacity, handler_type handler )
+            :_name( name ), _handler( std::move( handler ) ), _ring( capacity )
+         {
+            _thread = std::thread( [this](){ run(); } );
+         }
+
+         ~async_event_subscriber()
+         {
+            stop();
+         }
+
+         const std::string& name()const { return _name; }
+         bool stopped()const { return _stopping.load(); }
+
+         /// called by the single publishing thread
+         void publish( std::shared_ptr< const Event > event )
+         {
+            if( _stopping.load() )
+               return;
+
+            queued_event item{ std::move( event ), fc::time_point::now() };
+            if( !_ring.push( std::move( item ) ) )
+            {
+               ++_producer_waits;
+               while( !_ring.push( std::move( item ) ) && !_stopping.load() )
+                  std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+            }
+
+            uint32_t pending = ++_published - _consumed.load();
+            if( pending > _max_pending.load() )
+               _max_pending.store( pending );
+
+            // pairs with the fence in run(), either the subscriber sees the event or this sees it waiting
+            std::atomic_thread_fence( std::memory_order_seq_cst );
+            if( _waiting.load() )
+            {
+               std::lock_guard< std::mutex > lock( _mutex );
+               _wakeup.notify_one();
+            }
+         }
+
+         /// handles the events already published and joins the thread
+         void stop()
+         {
+            {
+               std::lock_guard< std::mutex > lock( _mutex );
+               if( _stopping.exchange( true ) )
+                  return;
+               _wakeup.notify_one();
+            }
+            if( _thread.joinable() )
+               _thread.join();
+         }
+
+         event_subscriber_statistics get_statistics()const
+         {
+            event_subscriber_statistics stats;
+            stats.name           = _name;
+            stats.capacity       = _ring.capacity();
+            stats.published      = _published.load();
+            stats.consumed       = _consumed.load();
+            stats.pending        = stats.published - stats.consumed;
+            stats.max_pending    = _max_pending.load();
+            stats.producer_waits = _producer_waits.load();
+            stats.last_block_num = _last_block_num.load();
+            stats.last_lag_us    = _last_lag_us.load();
+            stats.max_lag_us     = _max_lag_us.load();
+            return stats;
+         }
+
+      private:
+         struct queued_event
+         {
+            std::shared_ptr< const Event >   event;
+            fc::time_point                   published;
+         };
+
+         void run()
+         {
+            queued_event item;
+            while( true )
+            {
+               if( !_ring.pop( item ) )
+               {
+                  std::unique_lock< std::mutex > lock( _mutex );
+                  _waiting.store( true );
+                  std::atomic_thread_fence( std::memory_order_seq_cst );
+                  _wakeup.wait( lock, [&](){ return !_ring.empty() || _stopping.load(); } );
+                  _waiting.store( false );
+                  if( _ring.empty() )
+                     return;
+                  continue;
+               }
+
+               try
+               {
+                  _handler( *item.event );
+               }
+               catch( const fc::exception& e )
+               {
+                  elog( "Caught exception in ${n} event handler: ${e}", ("n", _name)("e", e.to_detail_string()) );
+               }
+               catch( const std::exception& e )
+               {
+                  elog( "Caught exception in ${n} event handler: ${e}", ("n", _name)("e", e.what()) );
+               }
+               catch( ... )
+               {
+                  elog( "Caught unknown exception in ${n} event handler", ("n", _name) );
+               }
+
+               int64_t lag = ( fc::time_point::now() - item.published ).count();
+               _last_block_num.store( item.event->block_num );
+               _last_lag_us.store( lag );
+               if( lag > _max_lag_us.load() )
+                  _max_lag_us.store( lag );
+               item = queued_event();
+               ++_consumed;
+            }
+         }
+
+         std::string                      _name;
+         handler_type                     _handler;
+         spsc_ring< queued_event >        _ring;
+
+         std::mutex                       _mutex;      ///< only to sleep on when the ring is empty
+         std::condition_variable          _wakeup;
+         std::atomic< bool >              _waiting{ false };
+         std::atomic< bool >              _stopping{ false };
+
+         std::atomic< uint64_t >          _published{ 0 };
+         std::atomic< uint64_t >          _consumed{ 0 };
+         std::atomic< uint32_t >          _max_pending{ 0 };
+         std::atomic< uint64_t >          _producer_waits{ 0 };
+         std::atomic< uint32_t >          _last_block_num{ 0 };
+         std::atomic< int64_t >           _last_lag_us{ 0 };
+         std::atomic< int64_t >           _max_lag_us{ 0 };
+
+         std::thread                      _thread;
+   };
+
+   /// An operation of an applied block, owning a copy of the operation
+   struct applied_operation_event
+   {
+      transaction_id_type  trx_id;
+      uint32_t             trx_in_block = 0;
+      uint16_t             op_in_trx = 0;
+      uint64_t             virtual_op = 0;
+      operation            op;
+   };
+
+   /**
+    *  A block applied to the chain, published once it and all its operations have been applied.
+    *  A block popped by a fork switch is not announced, the blocks of the new fork are published
+    *  with the same numbers again.  It carries everything subscribers get, they do not read the
+    *  database; block is the copy the fork database or the replay already holds.
+    */
+   struct applied_block_event
+   {
+      uint32_t                                  block_num = 0;
+      block_id_type                             block_id;
+      std::shared_ptr< const signed_block >     block;
+      uint64_t                                  aslot = 0;
+      uint32_t                                  last_irreversible_block_num = 0;
+      /// the operations and virtual operations in the order they were applied, only for subscribers asking for them
+      std::shared_ptr< const std::vector< applied_operation_event > > operations;
+   };
+
+   typedef async_event_subscriber< applied_block_event > applied_block_subscriber;
+
+} } // sigmaengine::chain
+
+FC_REFLECT( sigmaengine::chain::event_subscriber_statistics,
+   (name)(capacity)(published)(consumed)(pending)(max_pending)(producer_waits)(last_block_num)(last_lag_us)(max_lag_us) )
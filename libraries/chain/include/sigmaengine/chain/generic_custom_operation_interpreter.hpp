@@ -10,11 +10,19 @@
 
 #include <graphene/schema/schema.hpp>
 
+#include <fc/crypto/city.hpp>
 #include <fc/variant.hpp>
 
+#include <deque>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#ifndef SIGMAENGINE_DECODED_JSON_CACHE_SIZE
+   #define SIGMAENGINE_DECODED_JSON_CACHE_SIZE 4096
+#endif
+
 namespace sigmaengine { namespace chain {
 
 class database;
@@ -67,10 +75,7 @@ class generic_custom_operation_interpreter
       {
          try
          {
-            std::vector< CustomOperationType > custom_operations;
-            
-            get_inner_operation( outer_o, custom_operations );
-            apply_operations( custom_operations, operation( outer_o ) );
+            apply_operations( *get_decoded_json( outer_o.json ), operation( outer_o ) );
          } FC_CAPTURE_AND_RETHROW( (outer_o) )
       }
 
@@ -78,10 +83,7 @@ class generic_custom_operation_interpreter
       {
          try
          {
-            std::vector< CustomOperationType > custom_operations;
-            
-            get_inner_operation( outer_o, custom_operations );
-            apply_operations( custom_operations, operation( outer_o ) );
+            apply_operations( *get_decoded_json( outer_o.json ), operation( outer_o ) );
          } FC_CAPTURE_AND_RETHROW( (outer_o) )
       }
 
@@ -103,24 +105,50 @@ class generic_custom_operation_interpreter
       }
 
    private:
-      void get_inner_operation( const protocol::custom_json_operation& outer_op, std::vector< CustomOperationType >& custom_operations )
+      typedef std::shared_ptr< const std::vector< CustomOperationType > > decoded_operations_ptr;
+
+      struct decoded_json
+      {
+         std::string             json;
+         decoded_operations_ptr  operations;
+      };
+
+      /**
+       * A transaction is applied when it is pushed, again whenever pending transactions are restored, when a
+       * block is generated and when the block arrives.  Recently decoded json is kept, keyed by the json itself,
+       * so it is only parsed the first time.  Json which fails to decode is not kept.
+       */
+      decoded_operations_ptr get_decoded_json( const std::string& json )
       {
-         fc::variant v = fc::json::from_string( outer_op.json );
+         uint64_t key = fc::city_hash64( json.data(), json.size() );
+         auto itr = _decoded_json.find( key );
+         if( itr != _decoded_json.end() && itr->second.json == json )
+            return itr->second.operations;
 
-         if( v.is_array() && v.size() > 0 && v.get_array()[0].is_array() )
+         auto custom_operations = std::make_shared< std::vector< CustomOperationType > >();
+         get_inner_operation( json, *custom_operations );
+
+         if( itr != _decoded_json.end() )
          {
-            from_variant( v, custom_operations );
+            itr->second.json = json;
+            itr->second.operations = custom_operations;
          }
          else
          {
-            custom_operations.emplace_back();
-            from_variant( v, custom_operations[0] );
+            if( _decoded_json_order.size() >= SIGMAENGINE_DECODED_JSON_CACHE_SIZE )
+            {
+               _decoded_json.erase( _decoded_json_order.front() );
+               _decoded_json_order.pop_front();
+            }
+            _decoded_json.emplace( key, decoded_json{ json, custom_operations } );
+            _decoded_json_order.push_back( key );
          }
+         return custom_operations;
       }
 
-      void get_inner_operation( const protocol::custom_json_dapp_operation& outer_op, std::vector< CustomOperationType >& custom_operations )
+      void get_inner_operation( const std::string& json, std::vector< CustomOperationType >& custom_operations )
       {
-         fc::variant v = fc::json::from_string( outer_op.json );
+         fc::variant v = fc::json::from_string( json );
 
          if( v.is_array() && v.size() > 0 && v.get_array()[0].is_array() )
          {
@@ -150,6 +178,9 @@ class generic_custom_operation_interpreter
             custom_operations.push_back( fc::raw::unpack< CustomOperationType >( outer_op.data ) );
          }
       }
+
+      std::unordered_map< uint64_t, decoded_json >   _decoded_json;
+      std::deque< uint64_t >                         _decoded_json_order;
 };
 
 } }
@@ -107,6 +107,38 @@ namespace sigmaengine { namespace chain {
       >,
       allocator< account_history_object >
    > account_history_index;
+
+   /**
+    *  The sequence and the op_seq for each op tag the next account_history_object of an account
+    *  gets, so recording an operation does not have to find the last ones in account_history_index.
+    */
+   class account_history_sequence_object : public object< account_history_sequence_object_type, account_history_sequence_object >
+   {
+      public:
+         template< typename Constructor, typename Allocator >
+         account_history_sequence_object( Constructor&& c, allocator< Allocator > a )
+            :next_op_seq( a )
+         {
+            c( *this );
+         }
+
+         typedef bip::flat_map< uint32_t, uint32_t, std::less< uint32_t >, allocator< std::pair< uint32_t, uint32_t > > > op_seq_map;
+
+         id_type           id;
+
+         account_name_type account;
+         uint32_t          next_sequence = 0;
+         op_seq_map        next_op_seq;      ///< by op tag
+   };
+
+   typedef multi_index_container<
+      account_history_sequence_object,
+      indexed_by<
+         ordered_unique< tag< by_id >, member< account_history_sequence_object, account_history_sequence_id_type, &account_history_sequence_object::id > >,
+         ordered_unique< tag< by_account >, member< account_history_sequence_object, account_name_type, &account_history_sequence_object::account > >
+      >,
+      allocator< account_history_sequence_object >
+   > account_history_sequence_index;
 } }
 
 FC_REFLECT( sigmaengine::chain::operation_object, (id)(trx_id)(block)(trx_in_block)(op_in_trx)(virtual_op)(timestamp)(serialized_op) )
@@ -114,3 +146,6 @@ CHAINBASE_SET_INDEX_TYPE( sigmaengine::chain::operation_object, sigmaengine::cha
 
 FC_REFLECT( sigmaengine::chain::account_history_object, (id)(account)(sequence)(op_tag)(op_seq)(op) )
 CHAINBASE_SET_INDEX_TYPE( sigmaengine::chain::account_history_object, sigmaengine::chain::account_history_index )
+
+FC_REFLECT( sigmaengine::chain::account_history_sequence_object, (id)(account)(next_sequence)(next_op_seq) )
+CHAINBASE_SET_INDEX_TYPE( sigmaengine::chain::account_history_sequence_object, sigmaengine::chain::account_history_sequence_index )
@@ -7,7 +7,15 @@ namespace sigmaengine { namespace chain {
 template< typename MultiIndexType >
 void _add_index_impl( database& db )
 {
-   db.add_index< MultiIndexType >();
+   try
+   {
+      db.add_index< MultiIndexType >();
+   }
+   catch( const std::runtime_error& e )
+   {
+      // the index layout changed since the shared memory file was written, an assert makes the node reindex
+      FC_ASSERT( false, "${e}, the chain state has to be rebuilt", ("e", e.what()) );
+   }
 }
 
 template< typename MultiIndexType >
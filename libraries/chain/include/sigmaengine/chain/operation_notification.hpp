@@ -16,6 +16,9 @@ struct operation_notification
    uint16_t            op_in_trx = 0;
    uint64_t            virtual_op = 0;
    const operation&    op;
+
+   /// set by database::get_operation_object(), the history plugins record the operation once
+   mutable const operation_object* op_obj = nullptr;
 };
 
 } }
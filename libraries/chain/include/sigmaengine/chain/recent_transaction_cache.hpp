@@ -0,0 +1,82 @@
+#pragma once
+#include <sigmaengine/protocol/config.hpp>
+#include <sigmaengine/protocol/transaction.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+
+#include <mutex>
+
+namespace sigmaengine { namespace chain {
+   using boost::multi_index_container;
+   using namespace boost::multi_index;
+
+   using sigmaengine::protocol::signed_transaction;
+   using sigmaengine::protocol::transaction_id_type;
+
+   /**
+    *  Keeps the bodies of recently seen transactions in process memory so they can
+    *  be served to peers (see database::get_recent_transaction).
+    *
+    *  This is not part of the consensus state.  Duplicate detection is done by
+    *  transaction_index, which only stores ids.  The cache is fed from the pending
+    *  pool and from applied blocks, entries are dropped once they expire and the
+    *  least recently used entries are evicted when max_size is exceeded.  The
+    *  database sets max_size to max_transactions() for the current maximum block
+    *  size, capped at a configured limit.  Unexpired transactions are only evicted
+    *  when more transactions arrive within the expiration window than that.
+    */
+   class recent_transaction_cache
+   {
+      public:
+         /// the fewest bytes a transaction takes in a block: a header, one operation and one signature
+         static const uint32_t min_transaction_size = 80;
+
+         /// how many transactions blocks of maximum_block_size hold until the oldest of them expires
+         static size_t max_transactions( uint32_t maximum_block_size )
+         {
+            return size_t( SIGMAENGINE_MAX_TIME_UNTIL_EXPIRATION / SIGMAENGINE_BLOCK_INTERVAL + 1 ) *
+                   ( maximum_block_size / min_transaction_size );
+         }
+
+         recent_transaction_cache( size_t max_size = 100000 );
+
+         void                                set_max_size( size_t max_size );
+         size_t                              max_size()const { return _max_size; }
+         size_t                              size()const;
+
+         void                                insert( const transaction_id_type& id, const signed_transaction& trx );
+         fc::optional< signed_transaction >  fetch( const transaction_id_type& id );
+         void                                clear_expired( const fc::time_point_sec& now );
+         void                                clear();
+
+      private:
+         struct cache_item
+         {
+            transaction_id_type  trx_id;
+            fc::time_point_sec   expiration;
+            signed_transaction   trx;
+         };
+
+         struct by_trx_id;
+         struct by_expiration;
+         typedef multi_index_container<
+            cache_item,
+            indexed_by<
+               sequenced<>,
+               hashed_unique< tag< by_trx_id >, member< cache_item, transaction_id_type, &cache_item::trx_id >, std::hash< transaction_id_type > >,
+               ordered_non_unique< tag< by_expiration >, member< cache_item, fc::time_point_sec, &cache_item::expiration > >
+            >
+         > cache_index_type;
+
+         void evict();
+
+         size_t                  _max_size;
+         cache_index_type        _index;
+         mutable std::mutex      _mutex;
+   };
+
+} } // sigmaengine::chain
@@ -2,6 +2,8 @@
 #include <sigmaengine/protocol/authority.hpp>
 #include <boost/interprocess/managed_mapped_file.hpp>
 
+#include <chainbase/chainbase.hpp>
+
 namespace sigmaengine { namespace chain {
    using sigmaengine::protocol::authority;
    using sigmaengine::protocol::public_key_type;
@@ -81,10 +83,10 @@ namespace sigmaengine { namespace chain {
       void     clear();
       void     validate()const;
 
-      typedef bip::allocator< shared_authority, bip::managed_mapped_file::segment_manager >                                allocator_type;
+      typedef chainbase::allocator< shared_authority >                                                                     allocator_type;
 
-      typedef bip::allocator< std::pair< account_name_type, weight_type >, bip::managed_mapped_file::segment_manager >     account_pair_allocator_type;
-      typedef bip::allocator< std::pair< public_key_type, weight_type >, bip::managed_mapped_file::segment_manager >       key_pair_allocator_type;
+      typedef chainbase::allocator< std::pair< account_name_type, weight_type > >                                          account_pair_allocator_type;
+      typedef chainbase::allocator< std::pair< public_key_type, weight_type > >                                            key_pair_allocator_type;
 
       typedef bip::flat_map< account_name_type, weight_type, std::less< account_name_type >, account_pair_allocator_type > account_authority_map;
       typedef bip::flat_map< public_key_type, weight_type, std::less< public_key_type >, key_pair_allocator_type >         key_authority_map;
@@ -58,7 +58,8 @@ enum object_type
    savings_withdraw_object_type,
    common_fund_object_type,
    fund_withdraw_object_type,
-   dapp_reward_fund_object_type
+   dapp_reward_fund_object_type,
+   account_history_sequence_object_type
 };
 
 class dynamic_global_property_object;
@@ -82,6 +83,7 @@ class common_fund_object;
 class account_auth_object;
 class fund_withdraw_object;
 class dapp_reward_fund_object;
+class account_history_sequence_object;
 
 typedef oid< dynamic_global_property_object         > dynamic_global_property_id_type;
 typedef oid< account_object                         > account_id_type;
@@ -104,6 +106,7 @@ typedef oid< common_fund_object                     > common_fund_id_type;
 typedef oid< fund_withdraw_object                   > fund_withdraw_id_type;
 typedef oid< account_auth_object                    > account_auth_id_type;
 typedef oid< dapp_reward_fund_object                > dapp_reward_fund_id_type;
+typedef oid< account_history_sequence_object        > account_history_sequence_id_type;
 
 enum bandwidth_type
 {
@@ -205,7 +208,14 @@ FC_REFLECT_ENUM( sigmaengine::chain::object_type,
                  (common_fund_object_type)
                  (fund_withdraw_object_type)
                  (dapp_reward_fund_object_type)
+                 (account_history_sequence_object_type)
                )
 
+FC_REFLECT( chainbase::index_statistics,
+            (type_name)(type_id)(object_count)(node_size)(allocated_bytes)(untracked_objects)
+            (undo_states)(undo_old_values)(undo_removed_values)(undo_new_ids)(undo_bytes) )
+FC_REFLECT( chainbase::size_class_statistics, (size)(slabs)(used_blocks)(free_blocks)(unused_bytes)(requested_bytes) )
+FC_REFLECT( chainbase::allocator_statistics, (size_classes)(segment_size)(segment_free_bytes)(classes) )
+
 FC_REFLECT_TYPENAME( sigmaengine::chain::shared_string )
 FC_REFLECT_TYPENAME( sigmaengine::chain::buffer_type )
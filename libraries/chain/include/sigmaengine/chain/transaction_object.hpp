@@ -13,6 +13,12 @@ namespace sigmaengine { namespace chain {
     * The purpose of this object is to enable the detection of duplicate transactions. When a transaction is included
     * in a block a transaction_object is added. At the end of block processing all transaction_objects that have
     * expired can be removed from the index.
+    *
+    * Only the id and expiration are kept in shared memory. Transaction bodies needed to serve peers live in the
+    * process local recent_transaction_cache.
+    *
+    * The ids stay chainbase objects rather than a set bucketed by expiration, so undo and fork switches handle
+    * them like any other state, and by_expiration already removes them in expiration order.
     */
    class transaction_object : public object< transaction_object_type, transaction_object >
    {
@@ -21,14 +27,12 @@ namespace sigmaengine { namespace chain {
       public:
          template< typename Constructor, typename Allocator >
          transaction_object( Constructor&& c, allocator< Allocator > a )
-            : packed_trx( a )
          {
             c( *this );
          }
 
          id_type              id;
 
-         bip::vector< char, allocator< char > > packed_trx;
          transaction_id_type  trx_id;
          time_point_sec       expiration;
    };
@@ -47,5 +51,5 @@ namespace sigmaengine { namespace chain {
 
 } } // sigmaengine::chain
 
-FC_REFLECT( sigmaengine::chain::transaction_object, (id)(packed_trx)(trx_id)(expiration) )
+FC_REFLECT( sigmaengine::chain::transaction_object, (id)(trx_id)(expiration) )
 CHAINBASE_SET_INDEX_TYPE( sigmaengine::chain::transaction_object, sigmaengine::chain::transaction_index )
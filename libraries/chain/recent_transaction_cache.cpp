@@ -0,0 +1,74 @@
+#include <sigmaengine/chain/recent_transaction_cache.hpp>
+
+namespace sigmaengine { namespace chain {
+
+recent_transaction_cache::recent_transaction_cache( size_t max_size )
+   : _max_size( max_size ) {}
+
+void recent_transaction_cache::set_max_size( size_t max_size )
+{
+   std::lock_guard< std::mutex > lock( _mutex );
+   _max_size = max_size;
+   evict();
+}
+
+size_t recent_transaction_cache::size()const
+{
+   std::lock_guard< std::mutex > lock( _mutex );
+   return _index.size();
+}
+
+void recent_transaction_cache::insert( const transaction_id_type& id, const signed_transaction& trx )
+{
+   std::lock_guard< std::mutex > lock( _mutex );
+   if( _max_size == 0 )
+      return;
+
+   const auto& id_idx = _index.get< by_trx_id >();
+   auto itr = id_idx.find( id );
+   if( itr != id_idx.end() )
+   {
+      // Already cached (e.g. pending transaction now included in a block), just mark it as recently used
+      _index.relocate( _index.begin(), _index.project< 0 >( itr ) );
+      return;
+   }
+
+   _index.push_front( cache_item{ id, trx.expiration, trx } );
+   evict();
+}
+
+fc::optional< signed_transaction > recent_transaction_cache::fetch( const transaction_id_type& id )
+{
+   std::lock_guard< std::mutex > lock( _mutex );
+   fc::optional< signed_transaction > result;
+   const auto& id_idx = _index.get< by_trx_id >();
+   auto itr = id_idx.find( id );
+   if( itr != id_idx.end() )
+   {
+      _index.relocate( _index.begin(), _index.project< 0 >( itr ) );
+      result = itr->trx;
+   }
+   return result;
+}
+
+void recent_transaction_cache::clear_expired( const fc::time_point_sec& now )
+{
+   std::lock_guard< std::mutex > lock( _mutex );
+   auto& exp_idx = _index.get< by_expiration >();
+   while( !exp_idx.empty() && now > exp_idx.begin()->expiration )
+      exp_idx.erase( exp_idx.begin() );
+}
+
+void recent_transaction_cache::clear()
+{
+   std::lock_guard< std::mutex > lock( _mutex );
+   _index.clear();
+}
+
+void recent_transaction_cache::evict()
+{
+   while( _index.size() > _max_size )
+      _index.pop_back();
+}
+
+} } // sigmaengine::chain
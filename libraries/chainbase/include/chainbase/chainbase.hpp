@@ -7,7 +7,9 @@
 #include <boost/interprocess/containers/deque.hpp>
 #include <boost/interprocess/containers/string.hpp>
 #include <boost/interprocess/allocators/allocator.hpp>
+#include <boost/interprocess/sync/interprocess_mutex.hpp>
 #include <boost/interprocess/sync/interprocess_sharable_mutex.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
 #include <boost/interprocess/sync/sharable_lock.hpp>
 #include <boost/interprocess/sync/file_lock.hpp>
 
@@ -24,9 +26,14 @@
 
 #include <array>
 #include <atomic>
+#include <condition_variable>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
+#include <tuple>
 #include <typeindex>
 #include <typeinfo>
 
@@ -34,6 +41,14 @@
    #define CHAINBASE_NUM_RW_LOCKS 10
 #endif
 
+#ifndef CHAINBASE_MAX_READ_RETRIES
+   #define CHAINBASE_MAX_READ_RETRIES 8
+#endif
+
+#ifndef CHAINBASE_FLUSH_CHUNK_SIZE
+   #define CHAINBASE_FLUSH_CHUNK_SIZE (16*1024*1024)
+#endif
+
 #ifdef CHAINBASE_CHECK_LOCKING
    #define CHAINBASE_REQUIRE_READ_LOCK(m, t) require_read_lock(m, typeid(t).name())
    #define CHAINBASE_REQUIRE_WRITE_LOCK(m, t) require_write_lock(m, typeid(t).name())
@@ -50,8 +65,208 @@ namespace chainbase {
    using std::shared_ptr;
    using std::vector;
 
+   typedef bip::managed_mapped_file::segment_manager segment_manager;
+
+   struct size_class_statistics
+   {
+      uint32_t size = 0;              ///< bytes of every block of the class
+      uint64_t slabs = 0;             ///< slabs taken from the segment manager
+      uint64_t used_blocks = 0;
+      uint64_t free_blocks = 0;       ///< freed blocks waiting on the free list
+      uint64_t unused_bytes = 0;      ///< not yet carved from the current slab
+      uint64_t requested_bytes = 0;   ///< asked for by the used blocks, the rest is rounding
+   };
+
+   struct allocator_statistics
+   {
+      bool                                 size_classes = false;   ///< built with CHAINBASE_SIZE_CLASS_ALLOCATOR
+      uint64_t                             segment_size = 0;
+      uint64_t                             segment_free_bytes = 0;
+      std::vector< size_class_statistics > classes;                ///< only the classes used so far
+   };
+
+   /**
+    *  Free lists of blocks of 16 to 512 bytes, one per multiple of 16, kept in the segment.  A
+    *  class takes slabs of slab_size bytes from the segment manager and carves its blocks from
+    *  them, freed blocks go to the free list of their class and are never returned to the segment
+    *  manager.  Larger requests go to the segment manager.
+    *
+    *  Every class has its own mutex, allocating a node is popping a free list or advancing the
+    *  slab instead of searching the best fitting block under the lock of the whole segment.
+    *  index_memory_usage only sees the slabs, it changes when an index operation takes one.
+    */
+   class size_class_pools
+   {
+      public:
+         static const uint32_t granularity = 16;
+         static const uint32_t class_count = 32;
+         static const uint32_t max_block_size = granularity * class_count;
+         static const uint32_t slab_size = 64 * 1024;
+
+         explicit size_class_pools( segment_manager* manager ):_manager( manager ){}
+
+         /**
+          *  The pools constructed in the segment by database::open(), cached per thread until
+          *  a database maps or unmaps a segment.
+          */
+         static size_class_pools* find( segment_manager* manager )
+         {
+            static thread_local segment_manager*   cached_manager = nullptr;
+            static thread_local size_class_pools*  cached_pools = nullptr;
+            static thread_local uint64_t           cached_epoch = 0;
+
+            uint64_t current = epoch().load( std::memory_order_acquire );
+            if( manager != cached_manager || current != cached_epoch )
+            {
+               // constructed with the segment and the only unique instance in it, nothing changes the
+               // unique index a lock would guard, and read only processes cannot lock the segment
+               auto pools = manager->find_no_lock< size_class_pools >( bip::unique_instance ).first;
+               if( !pools ) BOOST_THROW_EXCEPTION( std::runtime_error( "no size class pools in the segment" ) );
+               cached_manager = manager;
+               cached_pools = pools;
+               cached_epoch = current;
+            }
+            return cached_pools;
+         }
+
+         /// invalidates the cache of find(), called whenever a segment is mapped or unmapped
+         static void segment_mapping_changed() { ++epoch(); }
+
+         void* allocate( std::size_t bytes )
+         {
+            if( bytes == 0 || bytes > max_block_size )
+               return _manager->allocate( bytes );
+
+            size_class& c = _classes[ (bytes - 1) / granularity ];
+            bip::scoped_lock< bip::interprocess_mutex > lock( c.mutex );
+            ++c.used_blocks;
+            c.requested_bytes += bytes;
+            if( c.free_list )
+            {
+               free_block* block = c.free_list.get();
+               c.free_list = block->next;
+               --c.free_blocks;
+               return block;
+            }
+            uint32_t size = block_size( bytes );
+            if( c.slab_end - c.slab_next < size )
+               add_slab( c, size );
+            char* block = c.slab_next.get();
+            c.slab_next += size;
+            return block;
+         }
+
+         void deallocate( void* p, std::size_t bytes )
+         {
+            if( bytes == 0 || bytes > max_block_size )
+               return _manager->deallocate( p );
+
+            size_class& c = _classes[ (bytes - 1) / granularity ];
+            bip::scoped_lock< bip::interprocess_mutex > lock( c.mutex );
+            free_block* block = static_cast< free_block* >( p );
+            block->next = c.free_list;
+            c.free_list = block;
+            ++c.free_blocks;
+            --c.used_blocks;
+            c.requested_bytes -= bytes;
+         }
+
+         segment_manager* get_segment_manager()const { return _manager.get(); }
+
+         /**
+          *  Without lock the counters are read while other processes may change them, for read only
+          *  processes, which cannot lock the mutexes of a segment they mapped read only.
+          */
+         std::vector< size_class_statistics > get_statistics( bool lock = true )const;
+
+      private:
+         struct free_block
+         {
+            bip::offset_ptr< free_block > next;
+         };
+
+         struct size_class
+         {
+            bip::interprocess_mutex          mutex;
+            bip::offset_ptr< free_block >    free_list;
+            bip::offset_ptr< char >          slab_next;
+            bip::offset_ptr< char >          slab_end;
+            uint64_t                         slabs = 0;
+            uint64_t                         used_blocks = 0;
+            uint64_t                         free_blocks = 0;
+            uint64_t                         requested_bytes = 0;
+         };
+
+         static uint32_t block_size( std::size_t bytes ) { return ( (bytes - 1) / granularity + 1 ) * granularity; }
+
+         static std::atomic< uint64_t >& epoch()
+         {
+            static std::atomic< uint64_t > e( 1 );
+            return e;
+         }
+
+         void add_slab( size_class& c, uint32_t size );
+
+         bip::offset_ptr< segment_manager >  _manager;
+         size_class                          _classes[ class_count ];
+   };
+
+   /**
+    *  Allocates the blocks of up to size_class_pools::max_block_size bytes from the size class
+    *  pools of the segment.  Like bip::allocator it is a single offset pointer and is constructed
+    *  from the segment manager, so containers and objects use either one without changes.
+    */
+   template< typename T >
+   class size_class_allocator
+   {
+      public:
+         typedef T                                    value_type;
+         typedef bip::offset_ptr< T >                 pointer;
+         typedef bip::offset_ptr< const T >           const_pointer;
+         typedef bip::offset_ptr< void >              void_pointer;
+         typedef T&                                   reference;
+         typedef const T&                             const_reference;
+         typedef segment_manager::size_type           size_type;
+         typedef segment_manager::difference_type     difference_type;
+
+         template< typename U >
+         struct rebind { typedef size_class_allocator< U > other; };
+
+         size_class_allocator( segment_manager* manager ):_pools( size_class_pools::find( manager ) ){}
+
+         template< typename U >
+         size_class_allocator( const size_class_allocator< U >& other ):_pools( other.get_pools() ){}
+
+         pointer allocate( size_type n, const_pointer hint = const_pointer() )
+         {
+            if( n > max_size() ) throw bip::bad_alloc();
+            return pointer( static_cast< T* >( _pools->allocate( n * sizeof( T ) ) ) );
+         }
+
+         void deallocate( const pointer& p, size_type n )
+         {
+            _pools->deallocate( p.get(), n * sizeof( T ) );
+         }
+
+         size_type max_size()const { return get_segment_manager()->get_size() / sizeof( T ); }
+
+         segment_manager* get_segment_manager()const { return _pools->get_segment_manager(); }
+         size_class_pools* get_pools()const { return _pools.get(); }
+
+         friend bool operator == ( const size_class_allocator& a, const size_class_allocator& b ) { return a._pools == b._pools; }
+         friend bool operator != ( const size_class_allocator& a, const size_class_allocator& b ) { return a._pools != b._pools; }
+
+      private:
+         bip::offset_ptr< size_class_pools >  _pools;
+   };
+
+#ifdef CHAINBASE_SIZE_CLASS_ALLOCATOR
+   template<typename T>
+   using allocator = size_class_allocator<T>;
+#else
    template<typename T>
-   using allocator = bip::allocator<T, bip::managed_mapped_file::segment_manager>;
+   using allocator = bip::allocator<T, segment_manager>;
+#endif
 
    typedef bip::basic_string< char, std::char_traits< char >, allocator< char > > shared_string;
 
@@ -186,7 +401,7 @@ namespace chainbase {
          typedef bip::managed_mapped_file::segment_manager             segment_manager_type;
          typedef MultiIndexType                                        index_type;
          typedef typename index_type::value_type                       value_type;
-         typedef bip::allocator< generic_index, segment_manager_type > allocator_type;
+         typedef chainbase::allocator< generic_index >                 allocator_type;
          typedef undo_state< value_type >                              undo_state_type;
 
          generic_index( allocator<value_type> a )
@@ -203,22 +418,18 @@ namespace chainbase {
           */
          template<typename Constructor>
          const value_type& emplace( Constructor&& c ) {
-            auto new_id = _next_id;
-
-            auto constructor = [&]( value_type& v ) {
-               v.id = new_id;
-               c( v );
-            };
-
-            auto insert_result = _indices.emplace( constructor, _indices.get_allocator() );
-
-            if( !insert_result.second ) {
-               BOOST_THROW_EXCEPTION( std::logic_error("could not insert object, most likely a uniqueness constraint was violated") );
-            }
+            return insert_new( std::forward<Constructor>(c), false );
+         }
 
-            ++_next_id;
-            on_create( *insert_result.first );
-            return *insert_result.first;
+         /**
+          * Like emplace(), but every index first tries to insert the new element as its last one.
+          * That takes a single comparison per index when the element has the largest key, as objects
+          * created in id, block or sequence order during a replay do, and one more comparison than
+          * emplace() otherwise.  The resulting order, also among equal keys, is the same.
+          */
+         template<typename Constructor>
+         const value_type& emplace_at_end( Constructor&& c ) {
+            return insert_new( std::forward<Constructor>(c), true );
          }
 
          template<typename Modifier>
@@ -307,13 +518,54 @@ namespace chainbase {
          const index_type& indicies()const { return _indices; }
          int64_t revision()const { return _revision; }
 
+         /**
+          *  The database starts its sessions without touching the undo stack of every index, it
+          *  only advances the revision through this counter.  The undo state of that revision is
+          *  created by begin_undo_state() when the index is first modified.
+          */
+         int64_t* revision_counter() { return &_revision; }
+
+         /**
+          *  Creates the undo state of the current revision unless it already exists, returns true
+          *  if it was created.
+          */
+         bool begin_undo_state()
+         {
+            if( enabled() && _stack.back().revision == _revision )
+               return false;
+
+            _stack.emplace_back( _indices.get_allocator() );
+            _stack.back().old_next_id = _next_id;
+            _stack.back().revision = _revision;
+            return true;
+         }
+
+         /// number of undo states and the entries they hold
+         void get_undo_counts( uint64_t& states, uint64_t& old_values, uint64_t& removed_values, uint64_t& new_ids )const
+         {
+            states = _stack.size();
+            old_values = removed_values = new_ids = 0;
+            for( const auto& state : _stack )
+            {
+               old_values += state.old_values.size();
+               removed_values += state.removed_values.size();
+               new_ids += state.new_ids.size();
+            }
+         }
+
 
          /**
           *  Restores the state to how it was prior to the current session discarding all changes
           *  made between the last revision and the current revision.
+          *
+          *  Undo states are created lazily, so an index which was not modified in the current
+          *  revision has no state for it and only its revision is decremented.
           */
          void undo() {
-            if( !enabled() ) return;
+            if( !enabled() || _stack.back().revision != _revision ) {
+               --_revision;
+               return;
+            }
 
             const auto& head = _stack.back();
 
@@ -344,12 +596,23 @@ namespace chainbase {
           *  recent revision numbers into one revision number (reducing the head revision number)
           *
           *  This method does not change the state of the index, only the state of the undo buffer.
+          *  If the prior revision has no undo state, because the index was not modified in it, the
+          *  state of the current revision simply becomes the state of the prior revision.  If the
+          *  prior revision is at or below undo_floor it has no undo history at all, and the state
+          *  is dropped.
           */
-         void squash()
+         void squash( int64_t undo_floor = std::numeric_limits< int64_t >::max() )
          {
-            if( !enabled() ) return;
-            if( _stack.size() == 1 ) {
-               _stack.pop_front();
+            if( !enabled() || _stack.back().revision != _revision ) {
+               --_revision;
+               return;
+            }
+            if( _stack.size() == 1 || _stack[_stack.size()-2].revision != _revision - 1 ) {
+               if( _revision - 1 <= undo_floor )
+                  _stack.pop_back();
+               else
+                  _stack.back().revision = _revision - 1;
+               --_revision;
                return;
             }
 
@@ -483,6 +746,34 @@ namespace chainbase {
       private:
          bool enabled()const { return _stack.size(); }
 
+         template<typename Constructor>
+         const value_type& insert_new( Constructor&& c, bool at_end ) {
+            auto new_id = _next_id;
+
+            auto constructor = [&]( value_type& v ) {
+               v.id = new_id;
+               c( v );
+            };
+
+            typename index_type::iterator itr;
+            bool inserted;
+            if( at_end ) {
+               // emplace_hint() returns the conflicting element when the insertion fails
+               itr = _indices.emplace_hint( _indices.end(), constructor, _indices.get_allocator() );
+               inserted = itr->id == new_id;
+            } else {
+               std::tie( itr, inserted ) = _indices.emplace( constructor, _indices.get_allocator() );
+            }
+
+            if( !inserted ) {
+               BOOST_THROW_EXCEPTION( std::logic_error("could not insert object, most likely a uniqueness constraint was violated") );
+            }
+
+            ++_next_id;
+            on_create( *itr );
+            return *itr;
+         }
+
          void on_modify( const value_type& v ) {
             if( !enabled() ) return;
 
@@ -542,27 +833,94 @@ namespace chainbase {
          uint32_t                        _size_of_this = 0;
    };
 
-   class abstract_session {
-      public:
-         virtual ~abstract_session(){};
-         virtual void push()             = 0;
-         virtual void squash()           = 0;
-         virtual void undo()             = 0;
-         virtual int64_t revision()const  = 0;
+   /**
+    *  Net bytes one index allocated from the segment.  Every mutation of the index is bracketed
+    *  by reading the free memory of the segment, so object nodes, shared_string and buffer_type
+    *  payloads and undo states are all included.  Kept in the segment next to the index so it
+    *  survives restarts and can be read by read only processes.
+    */
+   struct index_memory_usage
+   {
+      int64_t  allocated_bytes = 0;
+      /// objects which already existed when tracking started, their bytes are not included
+      uint64_t untracked_objects = 0;
    };
 
-   template<typename SessionType>
-   class session_impl : public abstract_session
+   struct index_statistics
+   {
+      std::string type_name;
+      uint32_t    type_id = 0;
+      uint64_t    object_count = 0;
+      uint64_t    node_size = 0;           ///< bytes of one multi_index node, without payloads
+      int64_t     allocated_bytes = 0;     ///< see index_memory_usage, includes the undo states
+      uint64_t    untracked_objects = 0;
+      uint64_t    undo_states = 0;
+      uint64_t    undo_old_values = 0;
+      uint64_t    undo_removed_values = 0;
+      uint64_t    undo_new_ids = 0;
+      uint64_t    undo_bytes = 0;          ///< estimated from the entry counts, without payloads
+   };
+
+   class abstract_index;
+
+   /**
+    *  One open undo session of a database.  touched lists the indices which have an undo state
+    *  for revision, only those are visited when the session is pushed, squashed or undone.
+    */
+   struct undo_session_frame
+   {
+      int64_t                    revision = 0;
+      uint64_t                   serial = 0;
+      vector< abstract_index* >  touched;
+   };
+
+   /**
+    *  Process local stack of the open undo sessions.  Frames are reused so starting a session
+    *  does not allocate once the touched lists have grown to their working size.
+    */
+   class undo_session_stack
    {
       public:
-         session_impl( SessionType&& s ):_session( std::move( s ) ){}
+         bool   empty()const { return _depth == 0; }
+         size_t depth()const { return _depth; }
+
+         undo_session_frame& top() { return _frames[ _depth - 1 ]; }
+
+         /// the frame below the top, if it is the revision the top frame squashes into
+         undo_session_frame* parent()
+         {
+            if( _depth < 2 || _frames[ _depth - 2 ].revision != top().revision - 1 )
+               return nullptr;
+            return &_frames[ _depth - 2 ];
+         }
+
+         undo_session_frame& push( int64_t revision )
+         {
+            if( _depth == _frames.size() )
+               _frames.emplace_back();
+            auto& frame = _frames[ _depth++ ];
+            frame.revision = revision;
+            frame.serial = ++_serial;
+            frame.touched.clear();
+            return frame;
+         }
+
+         void pop()   { --_depth; }
+         void clear() { _depth = 0; }
+
+         /**
+          *  Revisions above the floor have undo history.  Changes made outside of a session while
+          *  the head revision is above it are recorded in the head revision, as they were when
+          *  every session created an undo state in every index.
+          */
+         int64_t undo_floor()const { return _undo_floor; }
+         void    set_undo_floor( int64_t revision ) { _undo_floor = revision; }
 
-         virtual void push() override  { _session.push();  }
-         virtual void squash() override{ _session.squash(); }
-         virtual void undo() override  { _session.undo();  }
-         virtual int64_t revision()const override  { return _session.revision();  }
       private:
-         SessionType _session;
+         vector< undo_session_frame >  _frames;
+         size_t                        _depth = 0;
+         uint64_t                      _serial = 0;
+         int64_t                       _undo_floor = std::numeric_limits< int64_t >::max();
    };
 
    class index_extension
@@ -577,10 +935,12 @@ namespace chainbase {
    class abstract_index
    {
       public:
-         abstract_index( void* i ):_idx_ptr(i){}
+         abstract_index( void* i, index_memory_usage* usage, const bip::managed_mapped_file::segment_manager* segment )
+         :_idx_ptr(i),_usage(usage),_segment(segment){}
          virtual ~abstract_index(){}
          virtual void     set_revision( int64_t revision ) = 0;
-         virtual unique_ptr<abstract_session> start_undo_session( bool enabled ) = 0;
+         virtual int64_t* revision_counter() = 0;
+         virtual bool     begin_undo_state() = 0;
 
          virtual int64_t revision()const = 0;
          virtual void    undo()const = 0;
@@ -588,43 +948,141 @@ namespace chainbase {
          virtual void    commit( int64_t revision )const = 0;
          virtual void    undo_all()const = 0;
          virtual uint32_t type_id()const  = 0;
+         virtual index_statistics get_statistics()const = 0;
 
          virtual void remove_object( int64_t id ) = 0;
 
+         /// looks the index up again after the segment was mapped at a new address
+         virtual void rebind( bip::managed_mapped_file& segment ) = 0;
+
          void add_index_extension( std::shared_ptr< index_extension > ext )  { _extensions.push_back( ext ); }
          const index_extensions& get_index_extensions()const  { return _extensions; }
          void* get()const { return _idx_ptr; }
+
+         index_memory_usage* memory_usage()const { return _usage; }
+         const bip::managed_mapped_file::segment_manager* segment()const { return _segment; }
+
+         void set_undo_sessions( undo_session_stack* sessions ) { _sessions = sessions; }
+
+         /**
+          *  Must be called before the index is modified.  On the first modification inside the
+          *  innermost undo session it creates the undo state of that session and records the index
+          *  as touched by it.
+          */
+         void prepare_undo()
+         {
+            if( !_sessions )
+               return;
+
+            if( !_sessions->empty() ) {
+               auto& frame = _sessions->top();
+               if( _touched_serial == frame.serial )
+                  return;
+
+               _touched_serial = frame.serial;
+               if( frame.revision == revision() ) {
+                  if( begin_undo_state() )
+                     frame.touched.push_back( this );
+                  return;
+               }
+            }
+
+            if( revision() > _sessions->undo_floor() )
+               begin_undo_state();
+         }
+      protected:
+         /// revisions at or below it have no undo history, see undo_session_stack::undo_floor()
+         int64_t undo_floor()const
+         {
+            return _sessions ? _sessions->undo_floor() : std::numeric_limits< int64_t >::max();
+         }
+
+         void set_mapping( void* i, index_memory_usage* usage, const bip::managed_mapped_file::segment_manager* segment )
+         {
+            _idx_ptr = i;
+            _usage = usage;
+            _segment = segment;
+         }
       private:
-         void*              _idx_ptr;
-         index_extensions   _extensions;
+         void*                                               _idx_ptr;
+         index_extensions                                    _extensions;
+         index_memory_usage*                                 _usage;
+         const bip::managed_mapped_file::segment_manager*    _segment;
+         undo_session_stack*                                 _sessions = nullptr;
+         uint64_t                                            _touched_serial = 0;
    };
 
-   template<typename BaseIndex>
-   class index_impl : public abstract_index {
+   /// adds the change of the segment's free memory during its lifetime to the index_memory_usage of an index
+   class memory_usage_scope
+   {
       public:
-         index_impl( BaseIndex& base ):abstract_index( &base ),_base(base){}
+         memory_usage_scope( const abstract_index& idx )
+         :_usage( idx.memory_usage() ),_segment( idx.segment() ),_free( _usage ? _segment->get_free_memory() : 0 ){}
 
-         virtual unique_ptr<abstract_session> start_undo_session( bool enabled ) override {
-            return unique_ptr<abstract_session>( new session_impl<typename BaseIndex::session>( _base.start_undo_session( enabled ) ) );
+         ~memory_usage_scope()
+         {
+            if( _usage )
+               _usage->allocated_bytes += int64_t( _free ) - int64_t( _segment->get_free_memory() );
          }
 
-         virtual void     set_revision( int64_t revision ) override { _base.set_revision( revision ); }
-         virtual int64_t  revision()const  override { return _base.revision(); }
-         virtual void     undo()const  override { _base.undo(); }
-         virtual void     squash()const  override { _base.squash(); }
-         virtual void     commit( int64_t revision )const  override { _base.commit(revision); }
-         virtual void     undo_all() const override {_base.undo_all(); }
+      private:
+         index_memory_usage*                                   _usage;
+         const bip::managed_mapped_file::segment_manager*      _segment;
+         size_t                                                _free;
+   };
+
+   template<typename BaseIndex>
+   class index_impl : public abstract_index {
+      public:
+         index_impl( BaseIndex& base, const std::string& type_name, index_memory_usage* usage )
+         :abstract_index( &base, usage, base.indices().get_allocator().get_segment_manager() ),_base(&base),_type_name(type_name){}
+
+         virtual void     set_revision( int64_t revision ) override { _base->set_revision( revision ); }
+         virtual int64_t* revision_counter() override { return _base->revision_counter(); }
+         virtual bool     begin_undo_state() override { return _base->begin_undo_state(); }
+         virtual int64_t  revision()const  override { return _base->revision(); }
+         virtual void     undo()const  override { memory_usage_scope scope( *this ); _base->undo(); }
+         virtual void     squash()const  override { memory_usage_scope scope( *this ); _base->squash( undo_floor() ); }
+         virtual void     commit( int64_t revision )const  override { memory_usage_scope scope( *this ); _base->commit(revision); }
+         virtual void     undo_all() const override { memory_usage_scope scope( *this ); _base->undo_all(); }
          virtual uint32_t type_id()const override { return BaseIndex::value_type::type_id; }
 
-         virtual void     remove_object( int64_t id ) override { return _base.remove_object( id ); }
+         virtual index_statistics get_statistics()const override {
+            index_statistics stats;
+            stats.type_name = _type_name;
+            stats.type_id = type_id();
+            stats.object_count = _base->indices().size();
+            stats.node_size = sizeof( typename BaseIndex::index_type::node_type );
+            if( memory_usage() ) {
+               stats.allocated_bytes = memory_usage()->allocated_bytes;
+               stats.untracked_objects = memory_usage()->untracked_objects;
+            }
+            _base->get_undo_counts( stats.undo_states, stats.undo_old_values, stats.undo_removed_values, stats.undo_new_ids );
+
+            // map and set nodes are a red black tree node around the stored value
+            const uint64_t tree_node = 4 * sizeof( void* );
+            stats.undo_bytes = stats.undo_states * sizeof( typename BaseIndex::undo_state_type )
+                             + ( stats.undo_old_values + stats.undo_removed_values ) * ( tree_node + sizeof( typename BaseIndex::undo_state_type::id_value_type_map::value_type ) )
+                             + stats.undo_new_ids * ( tree_node + sizeof( typename BaseIndex::value_type::id_type ) );
+            return stats;
+         }
+
+         virtual void     remove_object( int64_t id ) override { memory_usage_scope scope( *this ); prepare_undo(); return _base->remove_object( id ); }
+         virtual void     rebind( bip::managed_mapped_file& segment ) override {
+            BaseIndex* base = segment.find< BaseIndex >( _type_name.c_str() ).first;
+            if( !base ) BOOST_THROW_EXCEPTION( std::runtime_error( "unable to find index for " + _type_name + " after remapping" ) );
+            _base = base;
+            set_mapping( base, segment.find< index_memory_usage >( ( _type_name + "::memory_usage" ).c_str() ).first, segment.get_segment_manager() );
+         }
       private:
-         BaseIndex& _base;
+         BaseIndex*     _base;
+         std::string    _type_name;
    };
 
    template<typename IndexType>
    class index : public index_impl<IndexType> {
       public:
-         index( IndexType& i ):index_impl<IndexType>( i ){}
+         index( IndexType& i, const std::string& type_name, index_memory_usage* usage ):index_impl<IndexType>( i, type_name, usage ){}
    };
 
 
@@ -654,12 +1112,70 @@ namespace chainbase {
             return _current_lock;
          }
 
+         read_write_mutex& get_lock( uint32_t num )
+         {
+            return _locks[ num % CHAINBASE_NUM_RW_LOCKS ];
+         }
+
       private:
          std::array< read_write_mutex, CHAINBASE_NUM_RW_LOCKS >     _locks;
          std::atomic< uint32_t >                                    _current_lock;
    };
 
 
+   /**
+    *  Lives in shared_memory.meta next to the lock manager so read only processes attached to
+    *  the same shared_memory.bin can follow the writer.
+    *
+    *  write_sequence is incremented when the writer takes the write lock and again when it
+    *  releases it, so it is odd while the state is being modified.  A writer that died in between
+    *  leaves it odd, the next writer makes it even again when it opens the file.  Read only
+    *  processes only read while holding the lock the writer currently uses and the value is even,
+    *  the same value after the read tells them the writer did not get in next to them after timing
+    *  out on that lock.  committed_revision is the revision of the last fully applied block.
+    *
+    *  durable_revision is the last committed_revision all changes of which are known to be on
+    *  disk.  The background flush does not stop the writer, so the file may also hold parts of
+    *  later changes, after flush() with no writer running it is exactly at that revision.
+    *
+    *  mapping_epoch is incremented by the writer each time it grows shared_memory.bin, read only
+    *  processes remap the file when it differs from the epoch they mapped it at.
+    */
+   class committed_state
+   {
+      public:
+         committed_state() : write_sequence( 0 ), committed_revision( -1 ), durable_revision( -1 ), mapping_epoch( 0 ) {}
+
+         std::atomic< uint64_t >                                    write_sequence;
+         std::atomic< int64_t >                                     committed_revision;
+         std::atomic< int64_t >                                     durable_revision;
+         std::atomic< uint64_t >                                    mapping_epoch;
+   };
+
+   /**
+    *  How shared_memory.bin is backed once it is mapped.  For explicit huge pages put the
+    *  shared file directory on a hugetlbfs mount, huge_pages only advises transparent huge pages,
+    *  which the kernel uses for file mappings on tmpfs.
+    */
+   struct mapping_options
+   {
+      bool     huge_pages = false;   ///< madvise(MADV_HUGEPAGE) on the segment
+      bool     prefault = false;     ///< read every page of the segment during open
+      uint64_t lock_bytes = 0;       ///< mlock this many bytes from the start of the segment, where the indexes live
+      int32_t  numa_node = -1;       ///< prefer this node for the pages of the segment, which are then prefaulted
+   };
+
+   struct mapping_stats
+   {
+      uint64_t open_microseconds = 0;
+      uint64_t prefault_microseconds = 0;
+      uint64_t minor_faults = 0;     ///< page faults taken by the process while opening
+      uint64_t major_faults = 0;
+      uint64_t locked_bytes = 0;
+      bool     huge_pages = false;   ///< the madvise was accepted
+      int32_t  numa_node = -1;       ///< the memory policy was accepted
+   };
+
    /**
     *  This class
     */
@@ -672,10 +1188,36 @@ namespace chainbase {
          };
 
          database():_session_signal( std::make_shared< session_signal >() ){}
+         ~database();
 
          void open( const bfs::path& dir, uint32_t write = read_only, uint64_t shared_file_size = 0 );
          void close();
          void flush();
+
+         /**
+          *  Starts a thread writing back dirty pages of the segment in CHAINBASE_FLUSH_CHUNK_SIZE
+          *  chunks, scanning at most bytes_per_second, so the whole file never has to be synced
+          *  at once.  After each pass it writes back what was dirtied in the meantime and syncs
+          *  the file without holding any lock, then records the revision committed before that
+          *  write back as durable.
+          */
+         void start_background_flush( uint64_t bytes_per_second );
+         void stop_background_flush();
+
+         /**
+          *  Grows shared_memory.bin by extra_bytes and maps it again.  Must be called by the writer
+          *  with the write lock held and no undo session open, references to objects and indexes
+          *  are invalid afterwards.  Read only processes map the larger file the next time they
+          *  take a read lock.
+          */
+         void grow( uint64_t extra_bytes );
+
+         /// applied by the next open()
+         void set_mapping_options( const mapping_options& options ) { _mapping_options = options; }
+         const mapping_stats& get_mapping_stats()const { return _mapping_stats; }
+
+         /// minor and major page faults of the whole process so far
+         static std::pair< uint64_t, uint64_t > get_page_faults();
          void wipe( const bfs::path& dir );
          void set_require_locking( bool enable_require_locking );
 
@@ -695,18 +1237,21 @@ namespace chainbase {
          }
 #endif
 
+         /**
+          *  Undo sessions only create undo states in the indices they modify, see
+          *  abstract_index::prepare_undo(), and push, squash and undo only visit those indices.
+          *  Sessions must be ended in reverse order of their creation.
+          */
          struct session {
             public:
                session( session&& s )
-                  :_index_sessions( std::move(s._index_sessions) ), _revision( s._revision ), _session_signal( s._session_signal )
+                  :_db( s._db ), _serial( s._serial ), _revision( s._revision ), _session_signal( s._session_signal )
                {
+                  s._db = nullptr;
                }
-               session( vector<std::unique_ptr<abstract_session>>&& s, std::shared_ptr< session_signal > sig )
-                  :_index_sessions( std::move(s) ), _session_signal( sig )
+               session( database& db, uint64_t serial, int64_t revision, std::shared_ptr< session_signal > sig )
+                  :_db( &db ), _serial( serial ), _revision( revision ), _session_signal( sig )
                {
-                  if( _index_sessions.size() )
-                     _revision = _index_sessions[0]->revision();
-                     
                   _session_signal->notify_on_start_session( _revision );
                }
 
@@ -716,22 +1261,22 @@ namespace chainbase {
 
                void push()
                {
-                  for( auto& i : _index_sessions ) i->push();
-                  _index_sessions.clear();
+                  if( _db ) _db->push_session( _serial );
+                  _db = nullptr;
                   if( _session_signal ) _session_signal->notify_on_push_session( _revision );
                }
 
                void squash()
                {
-                  for( auto& i : _index_sessions ) i->squash();
-                  _index_sessions.clear();
+                  if( _db ) _db->squash_session( _serial );
+                  _db = nullptr;
                   if( _session_signal ) _session_signal->notify_on_squash_session( _revision );
                }
 
                void undo()
                {
-                  for( auto& i : _index_sessions ) i->undo();
-                  _index_sessions.clear();
+                  if( _db ) _db->undo_session( _serial );
+                  _db = nullptr;
                   if( _session_signal ) _session_signal->notify_on_undo_session( _revision );
                }
 
@@ -741,13 +1286,23 @@ namespace chainbase {
                friend class database;
                session() {}
 
-               vector< std::unique_ptr<abstract_session> > _index_sessions;
+               database* _db = nullptr;
+               uint64_t _serial = 0;
                int64_t _revision = -1;
                std::shared_ptr< session_signal > _session_signal;
          };
 
          session start_undo_session( bool enabled );
 
+         /**
+          *  While bulk loading, create() inserts objects with generic_index::emplace_at_end(), for
+          *  replaying blocks which create most objects in key order.  The position is only a hint, so
+          *  undo sessions work as usual, replayed custom operations open them to undo a failed evaluator.
+          *  The mode can only be entered while no session is open.
+          */
+         void set_bulk_load( bool enable );
+         bool bulk_load()const { return _bulk_load; }
+
          int64_t revision()const {
              if( _index_list.size() == 0 ) return -1;
              return _index_list[0]->revision();
@@ -763,6 +1318,35 @@ namespace chainbase {
          {
              CHAINBASE_REQUIRE_WRITE_LOCK( "set_revision", int64_t );
              for( auto i : _index_list ) i->set_revision( revision );
+             _undo_sessions.set_undo_floor( revision );
+         }
+
+         /**
+          *  Publishes the revision of the last fully applied block to read only processes.
+          *  Called by the writer while it holds the write lock.
+          */
+         void set_committed_revision( int64_t revision )
+         {
+            CHAINBASE_REQUIRE_WRITE_LOCK( "set_committed_revision", int64_t );
+            if( _committed_state )
+               _committed_state->committed_revision.store( revision, std::memory_order_release );
+         }
+
+         /// -1 until the writer published a revision, or if the writer predates committed_state
+         int64_t committed_revision()const
+         {
+            return _committed_state ? _committed_state->committed_revision.load( std::memory_order_acquire ) : -1;
+         }
+
+         uint64_t write_sequence()const
+         {
+            return _committed_state ? _committed_state->write_sequence.load( std::memory_order_acquire ) : 0;
+         }
+
+         /// -1 if shared_memory.bin was never known to be consistent on disk
+         int64_t durable_revision()const
+         {
+            return _committed_state ? _committed_state->durable_revision.load( std::memory_order_acquire ) : -1;
          }
 
 
@@ -788,12 +1372,28 @@ namespace chainbase {
 
              idx_ptr->validate();
 
+             std::string usage_name = type_name + "::memory_usage";
+             index_memory_usage* usage = nullptr;
+             if( !_read_only ) {
+                usage = _segment->find< index_memory_usage >( usage_name.c_str() ).first;
+                if( !usage ) {
+                   usage = _segment->construct< index_memory_usage >( usage_name.c_str() )();
+                   usage->untracked_objects = idx_ptr->indices().size();
+                }
+             } else {
+                usage = _segment->find< index_memory_usage >( usage_name.c_str() ).first;
+             }
+
              if( type_id >= _index_map.size() )
                 _index_map.resize( type_id + 1 );
 
-             auto new_index = new index<index_type>( *idx_ptr );
+             auto new_index = new index<index_type>( *idx_ptr, type_name, usage );
+             new_index->set_undo_sessions( &_undo_sessions );
              _index_map[ type_id ].reset( new_index );
              _index_list.push_back( new_index );
+             _revision_counters.push_back( new_index->revision_counter() );
+             if( _index_list.size() == 1 )
+                _undo_sessions.set_undo_floor( new_index->revision() );
          }
 
          auto get_segment_manager() -> decltype( ((bip::managed_mapped_file*)nullptr)->get_segment_manager()) {
@@ -805,6 +1405,9 @@ namespace chainbase {
             return _segment->get_segment_manager()->get_free_memory();
          }
 
+         /// free memory of the segment and, with CHAINBASE_SIZE_CLASS_ALLOCATOR, the use of every size class
+         allocator_statistics get_allocator_statistics()const;
+
          template<typename MultiIndexType>
          bool has_index()const
          {
@@ -920,7 +1523,11 @@ namespace chainbase {
          {
              CHAINBASE_REQUIRE_WRITE_LOCK("modify", ObjectType);
              typedef typename get_index_type<ObjectType>::type index_type;
-             get_mutable_index<index_type>().modify( obj, m );
+             auto& idx = get_mutable_index<index_type>();
+             abstract_index& base = *_index_map[ ObjectType::type_id ];
+             memory_usage_scope scope( base );
+             base.prepare_undo();
+             idx.modify( obj, m );
          }
 
          template<typename ObjectType>
@@ -928,7 +1535,11 @@ namespace chainbase {
          {
              CHAINBASE_REQUIRE_WRITE_LOCK("remove", ObjectType);
              typedef typename get_index_type<ObjectType>::type index_type;
-             return get_mutable_index<index_type>().remove( obj );
+             auto& idx = get_mutable_index<index_type>();
+             abstract_index& base = *_index_map[ ObjectType::type_id ];
+             memory_usage_scope scope( base );
+             base.prepare_undo();
+             return idx.remove( obj );
          }
 
          template<typename ObjectType, typename Constructor>
@@ -936,7 +1547,24 @@ namespace chainbase {
          {
              CHAINBASE_REQUIRE_WRITE_LOCK("create", ObjectType);
              typedef typename get_index_type<ObjectType>::type index_type;
-             return get_mutable_index<index_type>().emplace( std::forward<Constructor>(con) );
+             auto& idx = get_mutable_index<index_type>();
+             abstract_index& base = *_index_map[ ObjectType::type_id ];
+             memory_usage_scope scope( base );
+             base.prepare_undo();
+             if( _bulk_load )
+                return idx.emplace_at_end( std::forward<Constructor>(con) );
+             return idx.emplace( std::forward<Constructor>(con) );
+         }
+
+         /// per index object counts, allocated bytes and undo stack sizes, in add_index order
+         std::vector< index_statistics > get_index_statistics()const
+         {
+            CHAINBASE_REQUIRE_READ_LOCK( "get_index_statistics", index_statistics );
+            std::vector< index_statistics > result;
+            result.reserve( _index_list.size() );
+            for( const abstract_index* idx : _index_list )
+               result.push_back( idx->get_statistics() );
+            return result;
          }
 
          template< typename Lambda >
@@ -948,6 +1576,15 @@ namespace chainbase {
             int_incrementer ii( _read_lock_count );
 #endif
 
+            if( _read_only && _committed_state )
+            {
+               // the outer read holds the lock and validates what is read here too, locking again
+               // would wait behind a writer queued on the lock it holds
+               if( in_mapping_read() )
+                  return callback();
+               return replica_read( callback, wait_micro, std::is_void< decltype( callback() ) >() );
+            }
+
             if( !wait_micro )
             {
                lock.lock();
@@ -958,6 +1595,9 @@ namespace chainbase {
                   BOOST_THROW_EXCEPTION( std::runtime_error( "unable to acquire lock" ) );
             }
 
+            // after the read lock, the writer only grows the file while holding the write lock
+            mapping_read_guard mapping( *this );
+
             return callback();
          }
 
@@ -987,6 +1627,7 @@ namespace chainbase {
                }
             }
 
+            write_sequence_guard guard( _committed_state );
             return callback();
          }
 
@@ -1007,9 +1648,124 @@ namespace chainbase {
          std::shared_ptr< session_signal > get_session_signal() { return _session_signal; }
 
       private:
+         /**
+          *  Keeps the segment mapped at its current address while a thread reads it, grow() and
+          *  read only processes picking up a grown file remap under the exclusive side.  A guard
+          *  nested in another one cannot remap, it throws when the file grew since the outer one
+          *  mapped it so that the outer read retries.
+          */
+         class mapping_read_guard
+         {
+            public:
+               mapping_read_guard( database& db ) : _db( db ) { _db.lock_mapping(); }
+               ~mapping_read_guard() { _db.unlock_mapping(); }
+            private:
+               database& _db;
+         };
+
+         void lock_mapping();
+         void unlock_mapping();
+         void remap();
+         /// true if a read only process has to remap the file before reading it
+         bool mapping_outdated()const;
+         /// true if this thread is inside a read of the segment
+         static bool in_mapping_read();
+
+         /// no-ops unless serial is the innermost open session
+         void push_session( uint64_t serial );
+         void squash_session( uint64_t serial );
+         void undo_session( uint64_t serial );
+
+         class write_sequence_guard
+         {
+            public:
+               write_sequence_guard( committed_state* state ) : _state( state )
+               {
+                  if( _state ) _state->write_sequence.fetch_add( 1, std::memory_order_acq_rel );
+               }
+               ~write_sequence_guard()
+               {
+                  if( _state ) _state->write_sequence.fetch_add( 1, std::memory_order_release );
+               }
+
+            private:
+               committed_state* _state;
+         };
+
+         void background_flush_loop( uint64_t bytes_per_second );
+         /// numa_node and prefault only apply when the file is first opened, not after a remap
+         void apply_mapping_options( bool initial );
+
+         /**
+          *  writes back dirty pages in [offset, offset + size) of the segment, blocking until done,
+          *  the device may still cache them
+          */
+         void write_back( int fd, size_t offset, size_t size );
+
+         /**
+          *  Takes a read lock on the lock the writer currently uses once no writer is in, returns the
+          *  even write sequence.  A writer that rotated to another lock after timing out on the one
+          *  taken is not excluded by it, then the lock is taken again.  Throws like with_read_lock
+          *  when this takes longer than wait_micro.
+          */
+         uint64_t begin_replica_read( read_lock& lock, uint64_t wait_micro );
+
+         /**
+          *  true if the state did not change since begin_replica_read() returned sequence,
+          *  throws once attempt exceeds CHAINBASE_MAX_READ_RETRIES
+          */
+         bool end_validated_read( uint64_t sequence, uint32_t attempt )const;
+
+         template< typename Lambda >
+         auto replica_read( Lambda& callback, uint64_t wait_micro, std::false_type ) -> decltype( callback() )
+         {
+            for( uint32_t attempt = 1; ; ++attempt )
+            {
+               read_lock lock;
+               uint64_t sequence = begin_replica_read( lock, wait_micro );
+               // taken again on every attempt, remaps if the writer grew the file during the last one
+               mapping_read_guard mapping( *this );
+               try
+               {
+                  decltype( callback() ) result = callback();
+                  if( end_validated_read( sequence, attempt ) )
+                     return result;
+               }
+               catch( ... )
+               {
+                  // a read racing the writer may fail on half written state, only report real failures
+                  if( end_validated_read( sequence, attempt ) )
+                     throw;
+               }
+            }
+         }
+
+         template< typename Lambda >
+         void replica_read( Lambda& callback, uint64_t wait_micro, std::true_type )
+         {
+            for( uint32_t attempt = 1; ; ++attempt )
+            {
+               read_lock lock;
+               uint64_t sequence = begin_replica_read( lock, wait_micro );
+               mapping_read_guard mapping( *this );
+               try
+               {
+                  callback();
+                  if( end_validated_read( sequence, attempt ) )
+                     return;
+               }
+               catch( ... )
+               {
+                  if( end_validated_read( sequence, attempt ) )
+                     throw;
+               }
+            }
+         }
+
          unique_ptr<bip::managed_mapped_file>                        _segment;
          unique_ptr<bip::managed_mapped_file>                        _meta;
          read_write_mutex_manager*                                   _rw_manager = nullptr;
+         committed_state*                                            _committed_state = nullptr;
          bool                                                        _read_only = false;
          bip::file_lock                                              _flock;
 
@@ -1023,12 +1779,30 @@ namespace chainbase {
           */
          vector<unique_ptr<abstract_index>>                          _index_map;
 
+         /// revision of every index in _index_list, advanced together when a session starts
+         vector<int64_t*>                                            _revision_counters;
+         undo_session_stack                                          _undo_sessions;
+
          bfs::path                                                   _data_dir;
 
          int32_t                                                     _read_lock_count = 0;
          int32_t                                                     _write_lock_count = 0;
          bool                                                        _enable_require_locking = false;
+         bool                                                        _bulk_load = false;
          std::shared_ptr< session_signal >                           _session_signal;
+
+         mapping_options                                             _mapping_options;
+         mapping_stats                                               _mapping_stats;
+
+         boost::shared_mutex                                         _mapping_mutex;
+         size_t                                                      _mapped_size = 0;
+         uint64_t                                                    _mapped_epoch = 0;
+         uint64_t                                                    _flush_rate = 0;
+
+         std::thread                                                 _flush_thread;
+         std::mutex                                                  _flush_mutex;
+         std::condition_variable                                     _flush_stop_cv;
+         bool                                                        _flush_stop = false;
    };
 
    template<typename Object, typename... Args>
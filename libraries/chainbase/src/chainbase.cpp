@@ -1,7 +1,21 @@
 #include <chainbase/chainbase.hpp>
 #include <boost/array.hpp>
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <thread>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 namespace chainbase {
    struct environment_check {
@@ -29,9 +43,51 @@ namespace chainbase {
       bool                    windows = false;
    };
 
+#ifdef CHAINBASE_SIZE_CLASS_ALLOCATOR
+   static const bool size_classes = true;
+#else
+   static const bool size_classes = false;
+#endif
+
+   void size_class_pools::add_slab( size_class& c, uint32_t size )
+   {
+      // the rest of the previous slab is too small for a block and stays unused
+      uint32_t bytes = std::max( slab_size - slab_size % size, size );
+      char* slab = static_cast< char* >( _manager->allocate( bytes ) );
+      c.slab_next = slab;
+      c.slab_end = slab + bytes;
+      ++c.slabs;
+   }
+
+   std::vector< size_class_statistics > size_class_pools::get_statistics( bool lock )const
+   {
+      std::vector< size_class_statistics > result;
+      for( uint32_t i = 0; i < class_count; ++i )
+      {
+         const size_class& c = _classes[i];
+         bip::scoped_lock< bip::interprocess_mutex > guard( const_cast< bip::interprocess_mutex& >( c.mutex ), bip::defer_lock );
+         if( lock )
+            guard.lock();
+         if( !c.slabs )
+            continue;
+
+         size_class_statistics stats;
+         stats.size = ( i + 1 ) * granularity;
+         stats.slabs = c.slabs;
+         stats.used_blocks = c.used_blocks;
+         stats.free_blocks = c.free_blocks;
+         stats.unused_bytes = c.slab_end - c.slab_next;
+         stats.requested_bytes = c.requested_bytes;
+         result.push_back( stats );
+      }
+      return result;
+   }
+
    void database::open( const bfs::path& dir, uint32_t flags, uint64_t shared_file_size ) {
 
       bool write = flags & database::read_write;
+      auto open_start = std::chrono::steady_clock::now();
+      auto faults_at_start = get_page_faults();
 
       if( !bfs::exists( dir ) ) {
 	  	
@@ -77,12 +133,24 @@ namespace chainbase {
          if( !env.first || !( *env.first == environment_check()) ) {
             BOOST_THROW_EXCEPTION( std::runtime_error( "database created by a different compiler, build, or operating system" ) );
          }
+
+         // blocks of one allocator must not be freed by the other
+         bool has_size_classes = _segment->find< size_class_pools >( bip::unique_instance ).first != nullptr;
+         if( has_size_classes != size_classes ) {
+            BOOST_THROW_EXCEPTION( std::runtime_error( has_size_classes
+               ? "database created with CHAINBASE_SIZE_CLASS_ALLOCATOR, this build does not use it"
+               : "database created without CHAINBASE_SIZE_CLASS_ALLOCATOR, this build uses it" ) );
+         }
       } else {
          _segment.reset( new bip::managed_mapped_file( bip::create_only,
                                                        abs_path.generic_string().c_str(), shared_file_size
                                                        ) );
          _segment->find_or_construct< environment_check >( "environment" )();
+         if( size_classes )
+            _segment->construct< size_class_pools >( bip::unique_instance )( _segment->get_segment_manager() );
       }
+      size_class_pools::segment_mapping_changed();
+      _mapped_size = _segment->get_size();
 
 
       abs_path = bfs::absolute( dir / "shared_memory.meta" );
@@ -95,47 +163,390 @@ namespace chainbase {
          _rw_manager = _meta->find< read_write_mutex_manager >( "rw_manager" ).first;
          if( !_rw_manager )
             BOOST_THROW_EXCEPTION( std::runtime_error( "could not find read write lock manager" ) );
+
+         // meta files written before committed_state existed still have room for it, readers
+         // attached to an older writer simply read without validation
+         if( write )
+         {
+            try
+            {
+               _committed_state = _meta->find_or_construct< committed_state >( "committed_state" )();
+            }
+            catch( const bip::bad_alloc& )
+            {
+               BOOST_THROW_EXCEPTION( std::runtime_error( "no room for committed state in shared_memory.meta, remove it while no process has the database open" ) );
+            }
+         }
+         else
+         {
+            _committed_state = _meta->find< committed_state >( "committed_state" ).first;
+         }
       }
       else
       {
          _meta.reset( new bip::managed_mapped_file( bip::create_only,
-                                                    abs_path.generic_string().c_str(), sizeof( read_write_mutex_manager ) * 2
+                                                    abs_path.generic_string().c_str(), sizeof( read_write_mutex_manager ) * 2 + sizeof( committed_state ) * 4
                                                     ) );
 
          _rw_manager = _meta->find_or_construct< read_write_mutex_manager >( "rw_manager" )();
+         _committed_state = _meta->find_or_construct< committed_state >( "committed_state" )();
       }
+      if( _committed_state )
+         _mapped_epoch = _committed_state->mapping_epoch.load( std::memory_order_acquire );
 
       if( write )
       {
          _flock = bip::file_lock( abs_path.generic_string().c_str() );
          if( !_flock.try_lock() )
             BOOST_THROW_EXCEPTION( std::runtime_error( "could not gain write access to the shared memory file" ) );
+
+         // a writer that died holding the write lock left the sequence odd, readers would wait for it
+         // forever and, once the next write made it even, take the writes for unchanged state
+         uint64_t sequence = _committed_state->write_sequence.load();
+         if( sequence & 1 )
+            _committed_state->write_sequence.store( sequence + 1 );
+      }
+
+      _mapping_stats = mapping_stats();
+      apply_mapping_options( true );
+
+      auto faults_at_end = get_page_faults();
+      _mapping_stats.minor_faults = faults_at_end.first - faults_at_start.first;
+      _mapping_stats.major_faults = faults_at_end.second - faults_at_start.second;
+      _mapping_stats.open_microseconds = std::chrono::duration_cast< std::chrono::microseconds >( std::chrono::steady_clock::now() - open_start ).count();
+   }
+
+   void database::apply_mapping_options( bool initial )
+   {
+#ifdef __linux__
+      char* base = (char*)_segment->get_address();
+      size_t size = _segment->get_size();
+
+      // MAP_SHARED mappings ignore mbind, page cache pages follow the policy of the faulting thread,
+      // so the opening thread prefers the node only while it prefaults the segment
+      const int mpol_default = 0;
+      const int mpol_preferred = 1;
+      if( initial && _mapping_options.numa_node >= 0 )
+      {
+         unsigned long nodemask = 1ul << _mapping_options.numa_node;
+         if( _mapping_options.numa_node < int32_t( sizeof( nodemask ) * 8 ) &&
+             syscall( SYS_set_mempolicy, mpol_preferred, &nodemask, sizeof( nodemask ) * 8 ) == 0 )
+            _mapping_stats.numa_node = _mapping_options.numa_node;
+         else
+            std::cerr << "Could not prefer NUMA node " << _mapping_options.numa_node << " for shared memory" << std::endl;
+      }
+
+      if( _mapping_options.huge_pages )
+      {
+#ifdef MADV_HUGEPAGE
+         _mapping_stats.huge_pages = madvise( base, size, MADV_HUGEPAGE ) == 0;
+#endif
+         if( !_mapping_stats.huge_pages )
+            std::cerr << "Transparent huge pages are not available for the shared memory file" << std::endl;
+      }
+
+      if( initial && ( _mapping_options.prefault || _mapping_stats.numa_node >= 0 ) )
+      {
+         auto prefault_start = std::chrono::steady_clock::now();
+         madvise( base, size, MADV_WILLNEED );
+         // read faults only, a write fault would dirty every page of the file
+         const size_t page_size = sysconf( _SC_PAGESIZE );
+         volatile char sink = 0;
+         for( size_t offset = 0; offset < size; offset += page_size )
+            sink += base[ offset ];
+         (void)sink;
+         _mapping_stats.prefault_microseconds = std::chrono::duration_cast< std::chrono::microseconds >( std::chrono::steady_clock::now() - prefault_start ).count();
+      }
+
+      if( initial && _mapping_stats.numa_node >= 0 )
+         syscall( SYS_set_mempolicy, mpol_default, nullptr, 0 );
+
+      if( _mapping_options.lock_bytes )
+      {
+         size_t lock_size = std::min< uint64_t >( _mapping_options.lock_bytes, size );
+         if( mlock( base, lock_size ) == 0 )
+            _mapping_stats.locked_bytes = lock_size;
+         else
+            std::cerr << "Could not mlock " << lock_size << " bytes of shared memory, check RLIMIT_MEMLOCK" << std::endl;
+      }
+#else
+      if( initial && ( _mapping_options.huge_pages || _mapping_options.prefault || _mapping_options.lock_bytes || _mapping_options.numa_node >= 0 ) )
+         std::cerr << "Shared memory mapping options are only supported on Linux" << std::endl;
+#endif
+   }
+
+   std::pair< uint64_t, uint64_t > database::get_page_faults()
+   {
+#ifndef WIN32
+      struct rusage usage;
+      if( getrusage( RUSAGE_SELF, &usage ) == 0 )
+         return std::make_pair( uint64_t( usage.ru_minflt ), uint64_t( usage.ru_majflt ) );
+#endif
+      return std::make_pair( uint64_t( 0 ), uint64_t( 0 ) );
+   }
+
+   database::~database()
+   {
+      stop_background_flush();
+   }
+
+   namespace {
+      /// managed_mapped_file::flush() only schedules the write back, this returns once the file is on disk
+      bool sync_file( bip::managed_mapped_file& file )
+      {
+#ifdef WIN32
+         return file.flush();
+#else
+         return msync( file.get_address(), file.get_size(), MS_SYNC ) == 0;
+#endif
       }
    }
 
    void database::flush() {
-      if( _segment )
-         _segment->flush();
+      bool synced = _segment && sync_file( *_segment );
+      // callers flush with the write lock held or with no writer, so the file matches the last commit
+      if( synced && _committed_state && !_read_only )
+         _committed_state->durable_revision.store( _committed_state->committed_revision.load() );
       if( _meta )
-         _meta->flush();
+         sync_file( *_meta );
+   }
+
+   void database::start_background_flush( uint64_t bytes_per_second )
+   {
+      if( _read_only || !_segment || !bytes_per_second )
+         return;
+      stop_background_flush();
+      _flush_stop = false;
+      _flush_rate = bytes_per_second;
+      _flush_thread = std::thread( [this, bytes_per_second]() { background_flush_loop( bytes_per_second ); } );
+   }
+
+   void database::stop_background_flush()
+   {
+      if( !_flush_thread.joinable() )
+         return;
+      {
+         std::lock_guard< std::mutex > guard( _flush_mutex );
+         _flush_stop = true;
+      }
+      _flush_stop_cv.notify_all();
+      _flush_thread.join();
+   }
+
+   void database::write_back( int fd, size_t offset, size_t size )
+   {
+#if defined(WIN32)
+      _segment->flush();
+#elif defined(__linux__)
+      // the page cache already knows which pages of a shared mapping are dirty
+      if( sync_file_range( fd, offset, size, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER ) == 0 )
+         return;
+      msync( (char*)_segment->get_address() + offset, size, MS_SYNC );
+#else
+      msync( (char*)_segment->get_address() + offset, size, MS_SYNC );
+#endif
+   }
+
+   void database::background_flush_loop( uint64_t bytes_per_second )
+   {
+      int fd = -1;
+#ifndef WIN32
+      fd = ::open( ( _data_dir / "shared_memory.bin" ).generic_string().c_str(), O_RDONLY );
+#endif
+      const size_t segment_size = _segment->get_size();
+      const auto chunk_time = std::chrono::microseconds( uint64_t( CHAINBASE_FLUSH_CHUNK_SIZE ) * 1000000 / bytes_per_second );
+
+      std::unique_lock< std::mutex > stop_lock( _flush_mutex );
+      while( !_flush_stop )
+      {
+         // paced pass over the whole segment, the writer keeps running
+         for( size_t offset = 0; offset < segment_size && !_flush_stop; offset += CHAINBASE_FLUSH_CHUNK_SIZE )
+         {
+            auto start = std::chrono::steady_clock::now();
+            stop_lock.unlock();
+            write_back( fd, offset, std::min< size_t >( CHAINBASE_FLUSH_CHUNK_SIZE, segment_size - offset ) );
+            stop_lock.lock();
+            _flush_stop_cv.wait_until( stop_lock, start + chunk_time, [this]() { return _flush_stop; } );
+         }
+         if( _flush_stop )
+            break;
+         stop_lock.unlock();
+
+         // unpaced catch up on what was dirtied during the pass, then sync without holding the
+         // writer off.  Every change of the revision committed before the catch up started is in
+         // a page written back by it, so that revision is on disk once the sync returns
+         int64_t revision = committed_revision();
+         write_back( fd, 0, segment_size );
+         if( !sync_file( *_segment ) )
+            std::cerr << "Background flush could not sync the database file" << std::endl;
+         else if( revision > durable_revision() )
+         {
+            _committed_state->durable_revision.store( revision, std::memory_order_release );
+            sync_file( *_meta );
+         }
+
+         stop_lock.lock();
+      }
+
+#ifndef WIN32
+      if( fd >= 0 )
+         ::close( fd );
+#endif
+   }
+
+   void database::grow( uint64_t extra_bytes )
+   {
+      CHAINBASE_REQUIRE_WRITE_LOCK( "grow", uint64_t );
+      if( _read_only )
+         BOOST_THROW_EXCEPTION( std::logic_error( "cannot grow the database file from a read only process" ) );
+
+      // the flusher scans the old mapping without any lock
+      bool flushing = _flush_thread.joinable();
+      stop_background_flush();
+
+      {
+         boost::unique_lock< boost::shared_mutex > lock( _mapping_mutex );
+         auto abs_path = bfs::absolute( _data_dir / "shared_memory.bin" );
+
+         // managed_mapped_file::grow maps the file itself, pages we dirtied stay in the page cache
+         _segment.reset();
+         bool grown = bip::managed_mapped_file::grow( abs_path.generic_string().c_str(), extra_bytes );
+         if( grown && _committed_state )
+            _committed_state->mapping_epoch.fetch_add( 1, std::memory_order_release );
+         remap();
+         if( !grown )
+            BOOST_THROW_EXCEPTION( std::runtime_error( "could not grow database file" ) );
+      }
+
+      if( flushing )
+         start_background_flush( _flush_rate );
+   }
+
+   void database::remap()
+   {
+      auto abs_path = bfs::absolute( _data_dir / "shared_memory.bin" );
+      // before mapping, a grow after this makes the mapping outdated again
+      if( _committed_state )
+         _mapped_epoch = _committed_state->mapping_epoch.load( std::memory_order_acquire );
+      if( _read_only )
+         _segment.reset( new bip::managed_mapped_file( bip::open_read_only, abs_path.generic_string().c_str() ) );
+      else
+         _segment.reset( new bip::managed_mapped_file( bip::open_only, abs_path.generic_string().c_str() ) );
+      _mapped_size = _segment->get_size();
+      size_class_pools::segment_mapping_changed();
+
+      for( size_t i = 0; i < _index_list.size(); ++i )
+      {
+         _index_list[i]->rebind( *_segment );
+         _revision_counters[i] = _index_list[i]->revision_counter();
+      }
+
+      apply_mapping_options( false );
+   }
+
+   namespace {
+      // with_read_lock may nest, only the outermost call takes the mapping lock
+      thread_local uint32_t mapping_read_depth = 0;
+   }
+
+   bool database::mapping_outdated()const
+   {
+      if( !_read_only )
+         return false;
+      if( _committed_state && _committed_state->mapping_epoch.load( std::memory_order_acquire ) != _mapped_epoch )
+         return true;
+      return _segment->get_size() != _mapped_size;
+   }
+
+   bool database::in_mapping_read()
+   {
+      return mapping_read_depth > 0;
+   }
+
+   void database::lock_mapping()
+   {
+      if( mapping_read_depth++ )
+      {
+         // the outer read holds the mapping, it retries from a fresh one
+         if( mapping_outdated() )
+         {
+            --mapping_read_depth;
+            BOOST_THROW_EXCEPTION( std::runtime_error( "database file grew during a nested read" ) );
+         }
+         return;
+      }
+
+      try
+      {
+         _mapping_mutex.lock_shared();
+         // the writer grew the file, map the new part before following pointers into it
+         while( mapping_outdated() )
+         {
+            _mapping_mutex.unlock_shared();
+            {
+               boost::unique_lock< boost::shared_mutex > lock( _mapping_mutex );
+               if( mapping_outdated() )
+               {
+                  remap();
+                  std::cerr << "Mapped grown database file, " << _mapped_size << " bytes" << std::endl;
+               }
+            }
+            _mapping_mutex.lock_shared();
+         }
+      }
+      catch( ... )
+      {
+         --mapping_read_depth;
+         throw;
+      }
+   }
+
+   void database::unlock_mapping()
+   {
+      if( --mapping_read_depth == 0 )
+         _mapping_mutex.unlock_shared();
    }
 
    void database::close()
    {
+      stop_background_flush();
       _segment.reset();
       _meta.reset();
+      size_class_pools::segment_mapping_changed();
+      _rw_manager = nullptr;
+      _committed_state = nullptr;
       _data_dir = bfs::path();
+      _bulk_load = false;
    }
 
    void database::wipe( const bfs::path& dir )
    {
+      stop_background_flush();
       _segment.reset();
       _meta.reset();
+      size_class_pools::segment_mapping_changed();
+      _rw_manager = nullptr;
+      _committed_state = nullptr;
       bfs::remove_all( dir / "shared_memory.bin" );
       bfs::remove_all( dir / "shared_memory.meta" );
       _data_dir = bfs::path();
       _index_list.clear();
       _index_map.clear();
+      _revision_counters.clear();
+      _undo_sessions.clear();
+      _bulk_load = false;
+   }
+
+   allocator_statistics database::get_allocator_statistics()const
+   {
+      CHAINBASE_REQUIRE_READ_LOCK( "get_allocator_statistics", allocator_statistics );
+      allocator_statistics stats;
+      stats.size_classes = size_classes;
+      stats.segment_size = _segment->get_size();
+      stats.segment_free_bytes = _segment->get_free_memory();
+      if( size_classes )
+         stats.classes = size_class_pools::find( _segment->get_segment_manager() )->get_statistics( !_read_only );
+      return stats;
    }
 
    void database::set_require_locking( bool enable_require_locking )
@@ -154,6 +565,40 @@ namespace chainbase {
    }
 #endif
 
+   uint64_t database::begin_replica_read( read_lock& lock, uint64_t wait_micro )
+   {
+      auto deadline = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::microseconds( wait_micro );
+      while( true )
+      {
+         uint32_t lock_num = _rw_manager->current_lock_num();
+         lock = read_lock( _rw_manager->get_lock( lock_num ), bip::defer_lock_type() );
+         if( !wait_micro )
+            lock.lock();
+         else if( !lock.timed_lock( deadline ) )
+            BOOST_THROW_EXCEPTION( std::runtime_error( "unable to acquire lock" ) );
+
+         uint64_t sequence = _committed_state->write_sequence.load( std::memory_order_acquire );
+         if( !( sequence & 1 ) && lock_num == _rw_manager->current_lock_num() )
+            return sequence;
+
+         // the writer rotated away from this lock and is in, or died while in
+         lock.unlock();
+         if( wait_micro && boost::posix_time::microsec_clock::universal_time() > deadline )
+            BOOST_THROW_EXCEPTION( std::runtime_error( "unable to acquire lock" ) );
+         std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+      }
+   }
+
+   bool database::end_validated_read( uint64_t sequence, uint32_t attempt )const
+   {
+      std::atomic_thread_fence( std::memory_order_acquire );
+      if( _committed_state->write_sequence.load( std::memory_order_relaxed ) == sequence )
+         return true;
+      if( attempt >= CHAINBASE_MAX_READ_RETRIES )
+         BOOST_THROW_EXCEPTION( std::runtime_error( "chain state kept changing while reading it" ) );
+      return false;
+   }
+
    void database::undo()
    {
       for( auto& item : _index_list )
@@ -178,32 +623,93 @@ namespace chainbase {
       {
          item->commit( revision );
       }
+      _undo_sessions.set_undo_floor( std::max( _undo_sessions.undo_floor(), revision ) );
       _session_signal->notify_on_commit_session( revision );
    }
 
    void database::undo_all()
    {
+      _undo_sessions.clear();
+
+      // indices only have undo states for the revisions they were modified in, so each one
+      // unwinds to a different revision, the oldest of them is where the database is now
+      int64_t revision = std::numeric_limits< int64_t >::max();
       for( auto& item : _index_list )
       {
          item->undo_all();
+         revision = std::min( revision, item->revision() );
       }
+      for( auto& item : _index_list )
+      {
+         item->set_revision( revision );
+      }
+      _undo_sessions.set_undo_floor( revision );
       _session_signal->notify_on_undo_session( ALL_SESSION_CODE );
    }
 
    database::session database::start_undo_session( bool enabled )
    {
-      if( enabled ) {
-         vector< std::unique_ptr<abstract_session> > _sub_sessions;
-         _sub_sessions.reserve( _index_list.size() );
-         for( auto& item : _index_list ) {
-            _sub_sessions.push_back( item->start_undo_session( enabled ) );
-         }
-         return session( std::move( _sub_sessions ), _session_signal );
+      if( enabled && _index_list.size() ) {
+         for( auto counter : _revision_counters )
+            ++*counter;
+         auto& frame = _undo_sessions.push( *_revision_counters[0] );
+         return session( *this, frame.serial, frame.revision, _session_signal );
+      } else if( enabled ) {
+         return session( *this, 0, -1, _session_signal );
       } else {
          return session();
       }
    }
 
+   void database::set_bulk_load( bool enable )
+   {
+      if( enable && !_undo_sessions.empty() )
+         BOOST_THROW_EXCEPTION( std::logic_error( "cannot bulk load while an undo session is open" ) );
+      _bulk_load = enable;
+   }
+
+   void database::push_session( uint64_t serial )
+   {
+      if( _undo_sessions.empty() || _undo_sessions.top().serial != serial )
+         return;
+
+      // the undo states stay on the stacks of the touched indices
+      _undo_sessions.pop();
+   }
+
+   void database::squash_session( uint64_t serial )
+   {
+      if( _undo_sessions.empty() || _undo_sessions.top().serial != serial )
+         return;
+
+      auto& frame = _undo_sessions.top();
+      auto parent = _undo_sessions.parent();
+      for( auto idx : frame.touched )
+      {
+         idx->squash();
+         if( parent && std::find( parent->touched.begin(), parent->touched.end(), idx ) == parent->touched.end() )
+            parent->touched.push_back( idx );
+      }
+      for( auto counter : _revision_counters )
+         if( *counter == frame.revision )
+            --*counter;
+      _undo_sessions.pop();
+   }
+
+   void database::undo_session( uint64_t serial )
+   {
+      if( _undo_sessions.empty() || _undo_sessions.top().serial != serial )
+         return;
+
+      auto& frame = _undo_sessions.top();
+      for( auto idx : frame.touched )
+         idx->undo();
+      for( auto counter : _revision_counters )
+         if( *counter == frame.revision )
+            --*counter;
+      _undo_sessions.pop();
+   }
+
 }  // namespace chainbase
 
 
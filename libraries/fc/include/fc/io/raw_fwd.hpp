@@ -12,6 +12,8 @@
 #include <set>
 
 #define MAX_ARRAY_ALLOC_SIZE (1024*1024*10*30) 
+/// arrays and objects nested deeper in an unpacked variant are rejected, like fc::json does
+#define MAX_VARIANT_UNPACK_DEPTH 100
 
 namespace fc { 
    class time_point;
@@ -69,8 +71,10 @@ namespace fc {
 
     template<typename Stream> inline void pack( Stream& s, const variant_object& v );
     template<typename Stream> inline void unpack( Stream& s, variant_object& v );
+    template<typename Stream> inline void unpack( Stream& s, variant_object& v, uint32_t depth );
     template<typename Stream> inline void pack( Stream& s, const variant& v );
     template<typename Stream> inline void unpack( Stream& s, variant& v );
+    template<typename Stream> inline void unpack( Stream& s, variant& v, uint32_t depth );
 
     template<typename Stream> inline void pack( Stream& s, const path& v );
     template<typename Stream> inline void unpack( Stream& s, path& v );
@@ -54,6 +54,13 @@ namespace fc { namespace raw {
     }
     template<typename Stream> 
     inline void unpack( Stream& s, variant& v )
+    {
+      unpack( s, v, 0 );
+    }
+
+    /// depth is the number of arrays and objects v is nested in
+    template<typename Stream> 
+    inline void unpack( Stream& s, variant& v, uint32_t depth )
     {
       uint8_t t;
       unpack( s, t );
@@ -98,15 +105,20 @@ namespace fc { namespace raw {
          }
          case variant::array_type:
          {
-            variants val;
-            raw::unpack(s,val);
+            FC_ASSERT( depth < MAX_VARIANT_UNPACK_DEPTH, "variant nested too deep", ("depth", depth) );
+            unsigned_int size;
+            raw::unpack(s,size);
+            FC_ASSERT( size.value*sizeof(variant) < MAX_ARRAY_ALLOC_SIZE );
+            variants val( size.value );
+            for( auto& item : val )
+               raw::unpack( s, item, depth + 1 );
             v = fc::move(val);
             return;
          }
          case variant::object_type:
          {
             variant_object val; 
-            raw::unpack(s,val);
+            raw::unpack( s, val, depth );
             v = fc::move(val);
             return;
          }
@@ -129,6 +141,13 @@ namespace fc { namespace raw {
     template<typename Stream> 
     inline void unpack( Stream& s, variant_object& v ) 
     {
+       unpack( s, v, 0 );
+    }
+
+    template<typename Stream> 
+    inline void unpack( Stream& s, variant_object& v, uint32_t depth ) 
+    {
+       FC_ASSERT( depth < MAX_VARIANT_UNPACK_DEPTH, "variant nested too deep", ("depth", depth) );
        unsigned_int vs;
        unpack( s, vs );
 
@@ -139,7 +158,7 @@ namespace fc { namespace raw {
           fc::string key;
           fc::variant value;
           fc::raw::unpack(s,key);
-          fc::raw::unpack(s,value);
+          fc::raw::unpack( s, value, depth + 1 );
           mvo.set( fc::move(key), fc::move(value) );
        }
        v = fc::move(mvo);
@@ -19,6 +19,8 @@ namespace fc { namespace http {
       public:
          virtual ~websocket_connection(){}
          virtual void send_message( const std::string& message ) = 0;
+         /** sends message as a binary frame, transports without binary frames fall back to send_message */
+         virtual void send_binary_message( const std::string& message ) { send_message( message ); }
          virtual void close( int64_t code, const std::string& reason  ){};
          void on_message( const std::string& message ) { _on_message(message); }
          string on_http( const std::string& message ) { return _on_http(message); }
@@ -3,6 +3,7 @@
 #include <fc/optional.hpp>
 #include <fc/api.hpp>
 #include <fc/any.hpp>
+#include <fc/rpc/encoded_variant.hpp>
 #include <memory>
 #include <vector>
 #include <functional>
@@ -224,6 +225,12 @@ namespace fc {
          virtual variant send_callback( uint64_t callback_id, variants args = variants() ) = 0;
          virtual void    send_notice( uint64_t callback_id, variants args = variants() ) = 0;
 
+         /** sends a notice with the single argument arg, connections copy its encoding into the frame */
+         virtual void    send_encoded_notice( uint64_t callback_id, const rpc::encoded_variant& arg )
+         {
+            send_notice( callback_id, variants{ arg.get() } );
+         }
+
          variant receive_call( api_id_type api_id, const string& method_name, const variants& args = variants() )const
          {
             FC_ASSERT( _local_apis.size() > api_id );
@@ -515,6 +522,28 @@ namespace fc {
           uint64_t _callback_id;
           std::weak_ptr< fc::api_connection > _api_connection;
       };
+
+      template<>
+      class callback_functor<void(const rpc::encoded_variant&)>
+      {
+         public:
+          typedef void result_type;
+
+          callback_functor( std::weak_ptr< fc::api_connection > con, uint64_t id )
+          :_callback_id(id),_api_connection(con){}
+
+          void operator()( const rpc::encoded_variant& arg )const
+          {
+             std::shared_ptr< fc::api_connection > locked = _api_connection.lock();
+             if( !locked )
+                throw fc::eof_exception();
+             locked->send_encoded_notice( _callback_id, arg );
+          }
+
+         private:
+          uint64_t _callback_id;
+          std::weak_ptr< fc::api_connection > _api_connection;
+      };
    } // namespace detail
 
 } // fc
@@ -0,0 +1,48 @@
+#pragma once
+#include <fc/rpc/websocket_api.hpp>
+#include <fc/static_variant.hpp>
+
+namespace fc { namespace rpc {
+
+   /**
+    *  Every websocket frame carries exactly one binary_message packed with fc::raw,
+    *  the frame itself provides the length prefix.
+    */
+   typedef fc::static_variant< request, response > binary_message;
+
+   /**
+    *  Same calling convention as websocket_api_connection (call / notice / callback and
+    *  numeric or named api ids) but requests and replies are fc::raw packed instead of
+    *  JSON text, so neither side has to print or parse JSON.
+    *
+    *  Used by the node for rpc-binary-endpoint and by clients connecting to it.
+    */
+   class binary_websocket_api_connection : public websocket_api_connection
+   {
+      public:
+         binary_websocket_api_connection( fc::http::websocket_connection& c );
+         ~binary_websocket_api_connection();
+
+         virtual variant send_call(
+            api_id_type api_id,
+            string method_name,
+            variants args = variants() ) override;
+         virtual variant send_callback(
+            uint64_t callback_id,
+            variants args = variants() ) override;
+         virtual void send_notice(
+            uint64_t callback_id,
+            variants args = variants() ) override;
+         virtual void send_encoded_notice(
+            uint64_t callback_id,
+            const encoded_variant& arg ) override;
+
+      protected:
+         std::string on_binary_message(
+            const std::string& message,
+            bool send_message = true );
+
+         std::string send_binary( const binary_message& msg, bool send_message = true );
+   };
+
+} } // namespace fc::rpc
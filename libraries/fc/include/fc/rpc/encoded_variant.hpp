@@ -0,0 +1,37 @@
+#pragma once
+#include <fc/variant.hpp>
+#include <memory>
+#include <string>
+
+namespace fc { namespace rpc {
+
+   /**
+    *  A notice argument sent to many connections.  Its JSON text and its fc::raw packed form
+    *  are encoded once, when a connection of that format first needs them, and copied into the
+    *  notice frame of every connection as they are.  Copies share the encodings.
+    *
+    *  A callback taking a const encoded_variant& is sent as a notice through
+    *  api_connection::send_encoded_notice(), the remote side receives the plain variant.
+    */
+   class encoded_variant
+   {
+      public:
+         encoded_variant() {}
+         explicit encoded_variant( variant v );
+
+         bool               valid()const { return bool( _encodings ); }
+         const variant&     get()const;
+         const std::string& json()const;
+         const std::string& raw()const;
+
+      private:
+         struct encodings;
+         std::shared_ptr< encodings > _encodings;
+   };
+
+} // namespace rpc
+
+   void to_variant( const rpc::encoded_variant& var, variant& vo );
+   void from_variant( const variant& var, rpc::encoded_variant& vo );
+
+} // namespace fc
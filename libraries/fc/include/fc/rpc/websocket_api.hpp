@@ -23,6 +23,9 @@ namespace fc { namespace rpc {
          virtual void send_notice(
             uint64_t callback_id,
             variants args = variants() ) override;
+         virtual void send_encoded_notice(
+            uint64_t callback_id,
+            const encoded_variant& arg ) override;
 
       protected:
          std::string on_message(
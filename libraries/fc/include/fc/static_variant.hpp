@@ -12,14 +12,25 @@
 #pragma once
 #include <stdexcept>
 #include <typeinfo>
+#include <type_traits>
+#include <utility>
 #include <fc/exception/exception.hpp>
 
 namespace fc {
 
+/**
+ * Specialize to std::true_type for large, rarely used alternatives. They are then kept on the
+ * heap and the static_variant only stores a pointer to them, so every other alternative does
+ * not have to pay for their size. This is transparent to visitors, get() and serialization.
+ * The specialization must be visible before any static_variant containing T is instantiated.
+ */
+template<typename T>
+struct static_variant_out_of_line : std::false_type {};
+
 // Implementation details, the user should not import this:
 namespace impl {
 
-template<int64_t N, typename... Ts>
+template<typename... Ts>
 struct storage_ops;
 
 template<typename X, typename... Ts>
@@ -54,84 +65,89 @@ struct move_construct
    }
 };
 
-template<int64_t N, typename T, typename... Ts>
-struct storage_ops<N, T&, Ts...> {
-    static void del(int64_t n, void *data) {}
-    static void con(int64_t n, void *data) {}
-
-    template<typename visitor>
-    static typename visitor::result_type apply(int64_t n, void *data, visitor& v) {}
-
-    template<typename visitor>
-    static typename visitor::result_type apply(int64_t n, void *data, const visitor& v) {}
-
-    template<typename visitor>
-    static typename visitor::result_type apply(int64_t n, const void *data, visitor& v) {}
-
-    template<typename visitor>
-    static typename visitor::result_type apply(int64_t n, const void *data, const visitor& v) {}
-};
+/** How an alternative is laid out in the storage of the static_variant, inline or behind a pointer. */
+template<typename T>
+struct storage_type
+{
+    static const bool out_of_line = static_variant_out_of_line<T>::value;
+    static const size_t size = out_of_line ? sizeof(T*) : sizeof(T);
 
-template<int64_t N, typename T, typename... Ts>
-struct storage_ops<N, T, Ts...> {
-    static void del(int64_t n, void *data) {
-        if(n == N) reinterpret_cast<T*>(data)->~T();
-        else storage_ops<N + 1, Ts...>::del(n, data);
+    static T* ptr(void *data) {
+        return out_of_line ? *reinterpret_cast<T**>(data) : reinterpret_cast<T*>(data);
     }
-    static void con(int64_t n, void *data) {
-        if(n == N) new(reinterpret_cast<T*>(data)) T();
-        else storage_ops<N + 1, Ts...>::con(n, data);
+    static const T* ptr(const void *data) {
+        return out_of_line ? *reinterpret_cast<T* const*>(data) : reinterpret_cast<const T*>(data);
     }
 
-    template<typename visitor>
-    static typename visitor::result_type apply(int64_t n, void *data, visitor& v) {
-        if(n == N) return v(*reinterpret_cast<T*>(data));
-        else return storage_ops<N + 1, Ts...>::apply(n, data, v);
+    template<typename... Args>
+    static void construct(void *data, Args&&... args) {
+        if( out_of_line ) *reinterpret_cast<T**>(data) = new T( std::forward<Args>(args)... );
+        else new(data) T( std::forward<Args>(args)... );
     }
-
-    template<typename visitor>
-    static typename visitor::result_type apply(int64_t n, void *data, const visitor& v) {
-        if(n == N) return v(*reinterpret_cast<T*>(data));
-        else return storage_ops<N + 1, Ts...>::apply(n, data, v);
+    static void construct_default(void *data) { construct(data); }
+    static void destroy(void *data) {
+        if( out_of_line ) delete *reinterpret_cast<T**>(data);
+        else reinterpret_cast<T*>(data)->~T();
     }
+};
 
-    template<typename visitor>
-    static typename visitor::result_type apply(int64_t n, const void *data, visitor& v) {
-        if(n == N) return v(*reinterpret_cast<const T*>(data));
-        else return storage_ops<N + 1, Ts...>::apply(n, data, v);
+/**
+ * Dispatches on the tag through a table with one entry per alternative instead of comparing the
+ * tag against every alternative in turn, so visiting is constant time regardless of the number
+ * of alternatives. Data is void* or const void*, Visitor may be const qualified.
+ */
+template<typename Visitor, typename Data, typename... Ts>
+struct jump_table
+{
+    typedef typename std::remove_const<Visitor>::type::result_type result_type;
+    typedef result_type (*entry_type)(Data, Visitor&);
+
+    template<typename T>
+    static result_type call(Data data, Visitor& v) {
+        return v( *storage_type<T>::ptr(data) );
     }
 
-    template<typename visitor>
-    static typename visitor::result_type apply(int64_t n, const void *data, const visitor& v) {
-        if(n == N) return v(*reinterpret_cast<const T*>(data));
-        else return storage_ops<N + 1, Ts...>::apply(n, data, v);
+    static result_type apply(int64_t n, Data data, Visitor& v) {
+        static const entry_type table[] = { &call<Ts>... };
+        if( n < 0 || n >= int64_t(sizeof...(Ts)) )
+           FC_THROW_EXCEPTION( fc::assert_exception, "Internal error: static_variant tag is invalid." );
+        return table[n](data, v);
     }
 };
 
-template<int64_t N>
-struct storage_ops<N> {
+template<typename... Ts>
+struct storage_ops {
     static void del(int64_t n, void *data) {
-       FC_THROW_EXCEPTION( fc::assert_exception, "Internal error: static_variant tag is invalid.");
+        static void (*const table[])(void*) = { &storage_type<Ts>::destroy... };
+        if( n < 0 || n >= int64_t(sizeof...(Ts)) )
+           FC_THROW_EXCEPTION( fc::assert_exception, "Internal error: static_variant tag is invalid." );
+        table[n](data);
     }
     static void con(int64_t n, void *data) {
-       FC_THROW_EXCEPTION( fc::assert_exception, "Internal error: static_variant tag is invalid." );
+        static void (*const table[])(void*) = { &storage_type<Ts>::construct_default... };
+        if( n < 0 || n >= int64_t(sizeof...(Ts)) )
+           FC_THROW_EXCEPTION( fc::assert_exception, "Internal error: static_variant tag is invalid." );
+        table[n](data);
     }
 
     template<typename visitor>
     static typename visitor::result_type apply(int64_t n, void *data, visitor& v) {
-       FC_THROW_EXCEPTION( fc::assert_exception, "Internal error: static_variant tag is invalid." );
+        return jump_table<visitor, void*, Ts...>::apply(n, data, v);
     }
+
     template<typename visitor>
     static typename visitor::result_type apply(int64_t n, void *data, const visitor& v) {
-       FC_THROW_EXCEPTION( fc::assert_exception, "Internal error: static_variant tag is invalid." );
+        return jump_table<const visitor, void*, Ts...>::apply(n, data, v);
     }
+
     template<typename visitor>
     static typename visitor::result_type apply(int64_t n, const void *data, visitor& v) {
-       FC_THROW_EXCEPTION( fc::assert_exception, "Internal error: static_variant tag is invalid." );
+        return jump_table<visitor, const void*, Ts...>::apply(n, data, v);
     }
+
     template<typename visitor>
     static typename visitor::result_type apply(int64_t n, const void *data, const visitor& v) {
-       FC_THROW_EXCEPTION( fc::assert_exception, "Internal error: static_variant tag is invalid." );
+        return jump_table<const visitor, const void*, Ts...>::apply(n, data, v);
     }
 };
 
@@ -162,7 +178,7 @@ template<typename T, typename... Ts>
 struct type_info<T, Ts...> {
     static const bool no_reference_types = type_info<Ts...>::no_reference_types;
     static const bool no_duplicates = position<T, Ts...>::pos == -1 && type_info<Ts...>::no_duplicates;
-    static const size_t size = type_info<Ts...>::size > sizeof(T) ? type_info<Ts...>::size : sizeof(T&);
+    static const size_t size = type_info<Ts...>::size > storage_type<T>::size ? type_info<Ts...>::size : storage_type<T>::size;
     static const size_t count = 1 + type_info<Ts...>::count;
 };
 
@@ -187,13 +203,14 @@ class static_variant {
     template<typename X>
     void init(const X& x) {
         _tag = impl::position<X, Types...>::pos;
-        new(storage) X(x);
+        impl::storage_type<X>::construct( storage, x );
     }
 
     template<typename X>
     void init(X&& x) {
-        _tag = impl::position<X, Types...>::pos;
-        new(storage) X( std::move(x) );
+        typedef typename std::decay<X>::type value_type;
+        _tag = impl::position<value_type, Types...>::pos;
+        impl::storage_type<value_type>::construct( storage, std::forward<X>(x) );
     }
 
     template<typename StaticVariant>
@@ -213,7 +230,7 @@ public:
     static_variant()
     {
        _tag = 0;
-       impl::storage_ops<0, Types...>::con(0, storage);
+       impl::storage_ops<Types...>::con(0, storage);
     }
 
     template<typename... Other>
@@ -240,7 +257,7 @@ public:
         init(v);
     }
     ~static_variant() {
-       impl::storage_ops<0, Types...>::del(_tag, storage);
+       impl::storage_ops<Types...>::del(_tag, storage);
     }
 
 
@@ -284,8 +301,7 @@ public:
             "Type not in static_variant."
         );
         if(_tag == impl::position<X, Types...>::pos) {
-            void* tmp(storage);
-            return *reinterpret_cast<X*>(tmp);
+            return *impl::storage_type<X>::ptr(storage);
         } else {
             FC_THROW_EXCEPTION( fc::assert_exception, "static_variant does not contain a value of type ${t}", ("t",fc::get_typename<X>::name()) );
            //     std::string("static_variant does not contain value of type ") + typeid(X).name()
@@ -299,30 +315,29 @@ public:
             "Type not in static_variant."
         );
         if(_tag == impl::position<X, Types...>::pos) {
-            const void* tmp(storage);
-            return *reinterpret_cast<const X*>(tmp);
+            return *impl::storage_type<X>::ptr(storage);
         } else {
             FC_THROW_EXCEPTION( fc::assert_exception, "static_variant does not contain a value of type ${t}", ("t",fc::get_typename<X>::name()) );
         }
     }
     template<typename visitor>
     typename visitor::result_type visit(visitor& v) {
-        return impl::storage_ops<0, Types...>::apply(_tag, storage, v);
+        return impl::storage_ops<Types...>::apply(_tag, storage, v);
     }
 
     template<typename visitor>
     typename visitor::result_type visit(const visitor& v) {
-        return impl::storage_ops<0, Types...>::apply(_tag, storage, v);
+        return impl::storage_ops<Types...>::apply(_tag, storage, v);
     }
 
     template<typename visitor>
     typename visitor::result_type visit(visitor& v)const {
-        return impl::storage_ops<0, Types...>::apply(_tag, storage, v);
+        return impl::storage_ops<Types...>::apply(_tag, storage, v);
     }
 
     template<typename visitor>
     typename visitor::result_type visit(const visitor& v)const {
-        return impl::storage_ops<0, Types...>::apply(_tag, storage, v);
+        return impl::storage_ops<Types...>::apply(_tag, storage, v);
     }
 
     static int64_t count() { return static_cast< int64_t >( impl::type_info<Types...>::count ); }
@@ -330,7 +345,7 @@ public:
       FC_ASSERT( w < count() && w >= 0 );
       this->~static_variant();
       _tag = w;
-      impl::storage_ops<0, Types...>::con(_tag, storage);
+      impl::storage_ops<Types...>::con(_tag, storage);
     }
 
     int64_t which() const {return _tag;}
@@ -0,0 +1,120 @@
+#include <fc/rpc/binary_websocket_api.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/io/raw_variant.hpp>
+
+namespace fc { namespace rpc {
+
+binary_websocket_api_connection::~binary_websocket_api_connection()
+{
+}
+
+binary_websocket_api_connection::binary_websocket_api_connection( fc::http::websocket_connection& c )
+   : websocket_api_connection( c )
+{
+   // The call / notice / callback methods registered by websocket_api_connection are reused,
+   // only the handlers decoding the frames are replaced.
+   _connection.on_message_handler( [&]( const std::string& msg ){ on_binary_message(msg,true); } );
+   _connection.on_http_handler( [&]( const std::string& msg ){ return on_binary_message(msg,false); } );
+}
+
+std::string binary_websocket_api_connection::send_binary( const binary_message& msg, bool send_message /* = true */ )
+{
+   std::string data( fc::raw::pack_size( msg ), '\0' );
+   if( data.size() )
+   {
+      fc::datastream< char* > ds( &data[0], data.size() );
+      fc::raw::pack( ds, msg );
+   }
+   if( send_message )
+      _connection.send_binary_message( data );
+   return data;
+}
+
+variant binary_websocket_api_connection::send_call(
+   api_id_type api_id,
+   string method_name,
+   variants args /* = variants() */ )
+{
+   auto request = _rpc_state.start_remote_call(  "call", {api_id, std::move(method_name), std::move(args) } );
+   send_binary( request );
+   return _rpc_state.wait_for_response( *request.id );
+}
+
+variant binary_websocket_api_connection::send_callback(
+   uint64_t callback_id,
+   variants args /* = variants() */ )
+{
+   auto request = _rpc_state.start_remote_call( "callback", {callback_id, std::move(args) } );
+   send_binary( request );
+   return _rpc_state.wait_for_response( *request.id );
+}
+
+void binary_websocket_api_connection::send_notice(
+   uint64_t callback_id,
+   variants args /* = variants() */ )
+{
+   fc::rpc::request req{ optional<uint64_t>(), "notice", {callback_id, std::move(args)}};
+   send_binary( req );
+}
+
+void binary_websocket_api_connection::send_encoded_notice(
+   uint64_t callback_id,
+   const encoded_variant& arg )
+{
+   // the frame send_notice() sends, the null placeholder ending it packs to its type tag only
+   fc::rpc::request req{ optional<uint64_t>(), "notice", {callback_id, variants{ variant() }}};
+   std::string frame = send_binary( req, false );
+   FC_ASSERT( frame.size() && uint8_t( frame.back() ) == variant::null_type );
+   frame.pop_back();
+   frame += arg.raw();
+   _connection.send_binary_message( frame );
+}
+
+std::string binary_websocket_api_connection::on_binary_message(
+   const std::string& message,
+   bool send_message /* = true */ )
+{
+   try
+   {
+      binary_message msg;
+      fc::datastream< const char* > ds( message.data(), message.size() );
+      fc::raw::unpack( ds, msg );
+
+      if( msg.which() == binary_message::tag< request >::value )
+      {
+         const auto& call = msg.get< request >();
+         exception_ptr optexcept;
+         try
+         {
+            try
+            {
+               auto result = _rpc_state.local_call( call.method, call.params );
+               if( call.id )
+                  return send_binary( response( *call.id, result ), send_message );
+            }
+            FC_CAPTURE_AND_RETHROW( (call.method)(call.params) )
+         }
+         catch ( const fc::exception& e )
+         {
+            if( call.id )
+            {
+               optexcept = e.dynamic_copy_exception();
+            }
+         }
+         if( optexcept )
+            return send_binary( response( *call.id,  error_object{ 1, optexcept->to_detail_string(), fc::variant(*optexcept)} ), send_message );
+      }
+      else
+      {
+         _rpc_state.handle_reply( msg.get< response >() );
+      }
+   }
+   catch ( const fc::exception& e )
+   {
+      wdump((e.to_detail_string()));
+      return e.to_detail_string();
+   }
+   return string();
+}
+
+} } // namespace fc::rpc
@@ -0,0 +1,68 @@
+#include <fc/rpc/encoded_variant.hpp>
+#include <fc/io/json.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/io/raw_variant.hpp>
+
+#include <mutex>
+
+namespace fc { namespace rpc {
+
+struct encoded_variant::encodings
+{
+   encodings( variant v ) : value( std::move( v ) ) {}
+
+   variant          value;
+   std::once_flag   json_once;
+   std::once_flag   raw_once;
+   std::string      json;
+   std::string      raw;
+};
+
+encoded_variant::encoded_variant( variant v )
+   : _encodings( std::make_shared< encodings >( std::move( v ) ) )
+{
+}
+
+const variant& encoded_variant::get()const
+{
+   FC_ASSERT( _encodings );
+   return _encodings->value;
+}
+
+const std::string& encoded_variant::json()const
+{
+   FC_ASSERT( _encodings );
+   encodings& e = *_encodings;
+   std::call_once( e.json_once, [&e](){ e.json = fc::json::to_string( e.value ); } );
+   return e.json;
+}
+
+const std::string& encoded_variant::raw()const
+{
+   FC_ASSERT( _encodings );
+   encodings& e = *_encodings;
+   std::call_once( e.raw_once, [&e]()
+   {
+      e.raw.resize( fc::raw::pack_size( e.value ) );
+      if( e.raw.size() )
+      {
+         fc::datastream< char* > ds( &e.raw[0], e.raw.size() );
+         fc::raw::pack( ds, e.value );
+      }
+   });
+   return e.raw;
+}
+
+} // namespace rpc
+
+void to_variant( const rpc::encoded_variant& var, variant& vo )
+{
+   vo = var.valid() ? var.get() : variant();
+}
+
+void from_variant( const variant& var, rpc::encoded_variant& vo )
+{
+   vo = rpc::encoded_variant( var );
+}
+
+} // namespace fc
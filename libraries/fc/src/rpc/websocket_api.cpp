@@ -81,6 +81,21 @@ void websocket_api_connection::send_notice(
    _connection.send_message( fc::json::to_string(req) );
 }
 
+void websocket_api_connection::send_encoded_notice(
+   uint64_t callback_id,
+   const encoded_variant& arg )
+{
+   // the frame send_notice() sends, with the argument's JSON text in place of a null placeholder
+   fc::rpc::request req{ optional<uint64_t>(), "notice", {callback_id, variants{ variant() }}};
+   std::string frame = fc::json::to_string(req);
+   const std::string tail = "]]}";
+   FC_ASSERT( frame.size() > 4 + tail.size() && frame.compare( frame.size() - 4 - tail.size(), 4, "null" ) == 0 );
+   frame.resize( frame.size() - 4 - tail.size() );
+   frame += arg.json();
+   frame += tail;
+   _connection.send_message( frame );
+}
+
 std::string websocket_api_connection::on_message(
    const std::string& message,
    bool send_message /* = true */ )
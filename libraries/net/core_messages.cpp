@@ -28,6 +28,9 @@ namespace graphene { namespace net {
 
   const core_message_type_enum trx_message::type                             = core_message_type_enum::trx_message_type;
   const core_message_type_enum block_message::type                           = core_message_type_enum::block_message_type;
+  const core_message_type_enum compact_block_message::type                   = core_message_type_enum::compact_block_message_type;
+  const core_message_type_enum get_compact_block_txs_message::type           = core_message_type_enum::get_compact_block_txs_message_type;
+  const core_message_type_enum compact_block_txs_message::type               = core_message_type_enum::compact_block_txs_message_type;
   const core_message_type_enum item_ids_inventory_message::type              = core_message_type_enum::item_ids_inventory_message_type;
   const core_message_type_enum blockchain_item_ids_inventory_message::type   = core_message_type_enum::blockchain_item_ids_inventory_message_type;
   const core_message_type_enum fetch_blockchain_item_ids_message::type       = core_message_type_enum::fetch_blockchain_item_ids_message_type;
@@ -46,5 +49,14 @@ namespace graphene { namespace net {
   const core_message_type_enum get_current_connections_request_message::type = core_message_type_enum::get_current_connections_request_message_type;
   const core_message_type_enum get_current_connections_reply_message::type   = core_message_type_enum::get_current_connections_reply_message_type;
 
+  compact_block_message::compact_block_message( const block_message& full ) :
+    header( full.block ),
+    block_id( full.block_id )
+  {
+    short_ids.reserve( full.block.transactions.size() );
+    for( const signed_transaction& trx : full.block.transactions )
+      short_ids.push_back( compact_block_short_id( trx.id() ) );
+  }
+
 } } // graphene::net
 
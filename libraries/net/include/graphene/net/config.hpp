@@ -23,7 +23,13 @@
  */
 #pragma once
 
-#define GRAPHENE_NET_PROTOCOL_VERSION                        106
+#define GRAPHENE_NET_PROTOCOL_VERSION                        107
+
+/**
+ * Peers at or above this version get compact_block_messages instead of full
+ * blocks during normal operation.
+ */
+#define GRAPHENE_NET_COMPACT_BLOCK_PROTOCOL_VERSION          107
 
 /**
  * Define this to enable debugging code in the p2p network interface.
@@ -68,6 +68,9 @@ namespace graphene { namespace net {
   {
     trx_message_type                             = 1000,
     block_message_type                           = 1001,
+    compact_block_message_type                   = 1002,
+    get_compact_block_txs_message_type           = 1003,
+    compact_block_txs_message_type               = 1004,
     core_message_type_first                      = 5000,
     item_ids_inventory_message_type              = 5001,
     blockchain_item_ids_inventory_message_type   = 5002,
@@ -115,6 +118,52 @@ namespace graphene { namespace net {
 
    };
 
+   /**
+    *  The first 8 bytes of a transaction id, used to refer to transactions the receiver
+    *  most likely already has in a compact_block_message.
+    */
+   inline uint64_t compact_block_short_id( const transaction_id_type& trx_id )
+   {
+      uint64_t short_id;
+      memcpy( &short_id, trx_id.data(), sizeof(short_id) );
+      return short_id;
+   }
+
+   /**
+    *  Sent instead of a block_message to peers speaking GRAPHENE_NET_COMPACT_BLOCK_PROTOCOL_VERSION
+    *  or later when the requested block is still in the sender's message cache, whether the
+    *  receiver asked for it during sync or during normal operation.  The receiver rebuilds the
+    *  block from the transactions in its message cache and asks for the ones it doesn't have
+    *  with a get_compact_block_txs_message.
+    */
+   struct compact_block_message
+   {
+      static const core_message_type_enum type;
+
+      compact_block_message(){}
+      compact_block_message( const block_message& full );
+
+      sigmaengine::protocol::signed_block_header header;
+      block_id_type                             block_id;
+      std::vector<uint64_t>                     short_ids;
+   };
+
+   struct get_compact_block_txs_message
+   {
+      static const core_message_type_enum type;
+
+      block_id_type           block_id;
+      std::vector<uint32_t>   indexes; ///< positions in compact_block_message::short_ids
+   };
+
+   struct compact_block_txs_message
+   {
+      static const core_message_type_enum type;
+
+      block_id_type                     block_id;
+      std::vector<signed_transaction>   transactions; ///< in the order of get_compact_block_txs_message::indexes
+   };
+
   struct item_ids_inventory_message
   {
     static const core_message_type_enum type;
@@ -403,6 +452,9 @@ namespace graphene { namespace net {
 FC_REFLECT_ENUM( graphene::net::core_message_type_enum,
                  (trx_message_type)
                  (block_message_type)
+                 (compact_block_message_type)
+                 (get_compact_block_txs_message_type)
+                 (compact_block_txs_message_type)
                  (core_message_type_first)
                  (item_ids_inventory_message_type)
                  (blockchain_item_ids_inventory_message_type)
@@ -425,6 +477,9 @@ FC_REFLECT_ENUM( graphene::net::core_message_type_enum,
 
 FC_REFLECT( graphene::net::trx_message, (trx) )
 FC_REFLECT( graphene::net::block_message, (block)(block_id) )
+FC_REFLECT( graphene::net::compact_block_message, (header)(block_id)(short_ids) )
+FC_REFLECT( graphene::net::get_compact_block_txs_message, (block_id)(indexes) )
+FC_REFLECT( graphene::net::compact_block_txs_message, (block_id)(transactions) )
 
 FC_REFLECT( graphene::net::item_id, (item_type)
                                (item_hash) )
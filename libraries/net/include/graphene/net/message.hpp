@@ -108,8 +108,11 @@ namespace graphene { namespace net {
      }
   };
 
-
-
+  /**
+   *  A message serialized once and then shared, read only, by the message cache and the
+   *  send queues of every peer it is sent to.
+   */
+  typedef std::shared_ptr<const message> message_ptr;
 
 } } // graphene::net
 
@@ -68,7 +68,7 @@ namespace graphene { namespace net
       virtual void on_message(peer_connection* originating_peer,
                               const message& received_message) = 0;
       virtual void on_connection_closed(peer_connection* originating_peer) = 0;
-      virtual message get_message_for_item(const item_id& item) = 0;
+      virtual message_ptr get_message_for_item(const item_id& item) = 0;
     };
 
     class peer_connection;
@@ -123,7 +123,8 @@ namespace graphene { namespace net
           enqueue_time(enqueue_time)
         {}
 
-        virtual message get_message(peer_connection_delegate* node) = 0;
+        /** the returned message stays valid until this queued_message is destroyed */
+        virtual const message& get_message(peer_connection_delegate* node) = 0;
         /** returns roughly the number of bytes of memory the message is consuming while
          * it is sitting on the queue
          */
@@ -145,7 +146,22 @@ namespace graphene { namespace net
           message_send_time_field_offset(message_send_time_field_offset)
         {}
 
-        message get_message(peer_connection_delegate* node) override;
+        const message& get_message(peer_connection_delegate* node) override;
+        size_t get_size_in_queue() override;
+      };
+
+      /* when you queue up a 'shared_queued_message', only a reference to a message
+       * that is also queued for other peers (or held in the message cache) is stored
+       */
+      struct shared_queued_message : queued_message
+      {
+        message_ptr    message_to_send;
+
+        shared_queued_message(message_ptr message_to_send) :
+          message_to_send(std::move(message_to_send))
+        {}
+
+        const message& get_message(peer_connection_delegate* node) override;
         size_t get_size_in_queue() override;
       };
 
@@ -155,13 +171,14 @@ namespace graphene { namespace net
        */
       struct virtual_queued_message : queued_message
       {
-        item_id item_to_send;
+        item_id     item_to_send;
+        message_ptr generated_message;
 
         virtual_queued_message(item_id item_to_send) :
           item_to_send(std::move(item_to_send))
         {}
 
-        message get_message(peer_connection_delegate* node) override;
+        const message& get_message(peer_connection_delegate* node) override;
         size_t get_size_in_queue() override;
       };
 
@@ -251,6 +268,14 @@ namespace graphene { namespace net
       timestamped_items_set_type inventory_advertised_to_peer;
 
       item_to_time_map_type items_requested_from_peer;  /// items we've requested from this peer during normal operation.  fetch from another peer if this peer disconnects
+
+      struct partial_compact_block
+      {
+        block_message         block;           /// transactions at missing_indexes are still default constructed
+        std::vector<uint32_t> missing_indexes;
+        bool                  requested_all_transactions = false;
+      };
+      std::map<block_id_type, partial_compact_block> compact_blocks_awaiting_transactions; /// compact blocks this peer sent us that wait for a compact_block_txs_message
       /// @}
 
       // if they're flooding us with transactions, we set this to avoid fetching for a few seconds to let the
@@ -284,6 +309,7 @@ namespace graphene { namespace net
 
       void send_queueable_message(std::unique_ptr<queued_message>&& message_to_send);
       void send_message(const message& message_to_send, size_t message_send_time_field_offset = (size_t)-1);
+      void send_message(const message_ptr& message_to_send);
       void send_item(const item_id& item_to_send);
       void close_connection();
       void destroy_connection();
@@ -26,6 +26,10 @@
 #include <fc/crypto/aes.hpp>
 #include <fc/crypto/elliptic.hpp>
 
+#include <initializer_list>
+#include <memory>
+#include <utility>
+
 namespace graphene { namespace net {
 
 /**
@@ -50,6 +54,13 @@ class stcp_socket : public virtual fc::iostream
     virtual size_t   writesome( const char* buffer, size_t len );
     virtual size_t   writesome( const std::shared_ptr<const char>& buf, size_t len, size_t offset );
 
+    /**
+     *  Encrypts and writes the concatenation of buffers, zero padded to a multiple of 16 bytes,
+     *  going through a small fixed staging buffer instead of first joining them into one
+     *  plaintext copy.  Returns the number of bytes written.
+     */
+    size_t           write_padded( std::initializer_list< std::pair<const char*, size_t> > buffers );
+
     virtual void     flush();
     virtual void     close();
 
@@ -68,6 +79,7 @@ class stcp_socket : public virtual fc::iostream
     fc::aes_decoder      _recv_aes;
     std::shared_ptr<char> _read_buffer;
     std::shared_ptr<char> _write_buffer;
+    std::unique_ptr<char[]> _plaintext_buffer;
 #ifndef NDEBUG
     bool _read_buffer_in_use;
     bool _write_buffer_in_use;
@@ -128,19 +128,22 @@ namespace graphene { namespace net {
 
       struct message_hash_index{};
       struct message_contents_hash_index{};
+      struct short_contents_hash_index{};
       struct block_clock_index{};
       struct message_info
       {
         message_hash_type message_hash;
-        message           message_body;
+        message_ptr       message_body;
         uint32_t          block_clock_when_received;
 
         // for network performance stats
         message_propagation_data propagation_data;
         fc::uint160_t     message_contents_hash; // hash of whatever the message contains (if it's a transaction, this is the transaction id, if it's a block, it's the block_id)
+        uint64_t          short_contents_hash; // compact_block_short_id() of message_contents_hash, for rebuilding compact blocks
+        mutable message_ptr compact_block_body; // compact_block_message of a cached block, built when it is first requested
 
         message_info( const message_hash_type& message_hash,
-                      const message&           message_body,
+                      const message_ptr&       message_body,
                       uint32_t                 block_clock_when_received,
                       const message_propagation_data& propagation_data,
                       fc::uint160_t            message_contents_hash ) :
@@ -148,7 +151,8 @@ namespace graphene { namespace net {
           message_body( message_body ),
           block_clock_when_received( block_clock_when_received ),
           propagation_data( propagation_data ),
-          message_contents_hash( message_contents_hash )
+          message_contents_hash( message_contents_hash ),
+          short_contents_hash( compact_block_short_id( message_contents_hash ) )
         {}
       };
       typedef boost::multi_index_container
@@ -157,6 +161,8 @@ namespace graphene { namespace net {
                                                   bmi::member<message_info, message_hash_type, &message_info::message_hash> >,
                              bmi::ordered_non_unique< bmi::tag<message_contents_hash_index>,
                                                       bmi::member<message_info, fc::uint160_t, &message_info::message_contents_hash> >,
+                             bmi::ordered_non_unique< bmi::tag<short_contents_hash_index>,
+                                                      bmi::member<message_info, uint64_t, &message_info::short_contents_hash> >,
                              bmi::ordered_non_unique< bmi::tag<block_clock_index>,
                                                       bmi::member<message_info, uint32_t, &message_info::block_clock_when_received> > >
         > message_cache_container;
@@ -170,10 +176,12 @@ namespace graphene { namespace net {
         block_clock( 0 )
       {}
       void block_accepted();
-      void cache_message( const message& message_to_cache, const message_hash_type& hash_of_message_to_cache,
+      void cache_message( const message_ptr& message_to_cache, const message_hash_type& hash_of_message_to_cache,
                         const message_propagation_data& propagation_data, const fc::uint160_t& message_content_hash );
-      message get_message( const message_hash_type& hash_of_message_to_lookup );
+      message_ptr get_message( const message_hash_type& hash_of_message_to_lookup );
+      message_ptr get_compact_block_message( const message_hash_type& hash_of_block_message_to_lookup );
       message_propagation_data get_message_propagation_data( const fc::uint160_t& hash_of_message_contents_to_lookup ) const;
+      fc::optional<signed_transaction> get_transaction_by_short_id( uint64_t short_id ) const;
       size_t size() const { return _message_cache.size(); }
     };
 
@@ -185,7 +193,7 @@ namespace graphene { namespace net {
                                                       _message_cache.get<block_clock_index>().lower_bound(block_clock - cache_duration_in_blocks ) );
     }
 
-    void blockchain_tied_message_cache::cache_message( const message& message_to_cache,
+    void blockchain_tied_message_cache::cache_message( const message_ptr& message_to_cache,
                                                      const message_hash_type& hash_of_message_to_cache,
                                                      const message_propagation_data& propagation_data,
                                                      const fc::uint160_t& message_content_hash )
@@ -197,7 +205,7 @@ namespace graphene { namespace net {
                                          message_content_hash ) );
     }
 
-    message blockchain_tied_message_cache::get_message( const message_hash_type& hash_of_message_to_lookup )
+    message_ptr blockchain_tied_message_cache::get_message( const message_hash_type& hash_of_message_to_lookup )
     {
       message_cache_container::index<message_hash_index>::type::const_iterator iter =
          _message_cache.get<message_hash_index>().find(hash_of_message_to_lookup );
@@ -206,6 +214,18 @@ namespace graphene { namespace net {
       FC_THROW_EXCEPTION(  fc::key_not_found_exception, "Requested message not in cache" );
     }
 
+    message_ptr blockchain_tied_message_cache::get_compact_block_message( const message_hash_type& hash_of_block_message_to_lookup )
+    {
+      message_cache_container::index<message_hash_index>::type::const_iterator iter =
+         _message_cache.get<message_hash_index>().find(hash_of_block_message_to_lookup );
+      if( iter == _message_cache.get<message_hash_index>().end() )
+        FC_THROW_EXCEPTION(  fc::key_not_found_exception, "Requested message not in cache" );
+      // the short ids are computed once per block and the message is shared by every peer it is sent to
+      if( !iter->compact_block_body )
+        iter->compact_block_body = std::make_shared<const message>( compact_block_message( iter->message_body->as<graphene::net::block_message>() ) );
+      return iter->compact_block_body;
+    }
+
     message_propagation_data blockchain_tied_message_cache::get_message_propagation_data( const fc::uint160_t& hash_of_message_contents_to_lookup ) const
     {
       if( hash_of_message_contents_to_lookup != fc::uint160_t() )
@@ -218,6 +238,17 @@ namespace graphene { namespace net {
       FC_THROW_EXCEPTION(  fc::key_not_found_exception, "Requested message not in cache" );
     }
 
+    fc::optional<signed_transaction> blockchain_tied_message_cache::get_transaction_by_short_id( uint64_t short_id ) const
+    {
+      // blocks share the index with transactions, and short ids may collide.  A wrong pick is caught
+      // by the merkle root check when the compact block is rebuilt
+      auto range = _message_cache.get<short_contents_hash_index>().equal_range( short_id );
+      for( auto iter = range.first; iter != range.second; ++iter )
+        if( iter->message_body->msg_type == trx_message_type )
+          return iter->message_body->as<trx_message>().trx;
+      return fc::optional<signed_transaction>();
+    }
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
 
     // This specifies configuration info for the local node.  It's stored as JSON
@@ -640,6 +671,21 @@ namespace graphene { namespace net { namespace detail {
       void on_fetch_items_message( peer_connection* originating_peer,
                                    const fetch_items_message& fetch_items_message_received );
 
+      void on_compact_block_message( peer_connection* originating_peer,
+                                     const compact_block_message& compact_block_message_received );
+
+      void on_get_compact_block_txs_message( peer_connection* originating_peer,
+                                             const get_compact_block_txs_message& get_compact_block_txs_message_received );
+
+      void on_compact_block_txs_message( peer_connection* originating_peer,
+                                         const compact_block_txs_message& compact_block_txs_message_received );
+
+      void request_compact_block_transactions( peer_connection* originating_peer,
+                                               peer_connection::partial_compact_block&& partial_block );
+
+      void process_compact_block( peer_connection* originating_peer,
+                                  peer_connection::partial_compact_block&& partial_block );
+
       void on_item_not_available_message( peer_connection* originating_peer,
                                           const item_not_available_message& item_not_available_message_received );
 
@@ -725,7 +771,8 @@ namespace graphene { namespace net { namespace detail {
       std::vector<peer_status> get_connected_peers() const;
       uint32_t                 get_connection_count() const;
 
-      void broadcast(const message& item_to_broadcast, const message_propagation_data& propagation_data);
+      void broadcast(const message_ptr& item_to_broadcast, const message_hash_type& hash_of_item_to_broadcast,
+                     const message_propagation_data& propagation_data);
       void broadcast(const message& item_to_broadcast);
       void sync_from(const item_id& current_head_block, const std::vector<uint32_t>& hard_fork_block_numbers);
       bool is_connected() const;
@@ -742,7 +789,7 @@ namespace graphene { namespace net { namespace detail {
       void                       set_total_bandwidth_limit( uint32_t upload_bytes_per_second, uint32_t download_bytes_per_second );
       void                       disable_peer_advertising();
       fc::variant_object         get_call_statistics() const;
-      message                    get_message_for_item(const item_id& item) override;
+      message_ptr                get_message_for_item(const item_id& item) override;
 
       fc::variant_object         network_get_info() const;
       fc::variant_object         network_get_usage_stats() const;
@@ -1811,6 +1858,15 @@ namespace graphene { namespace net { namespace detail {
       case core_message_type_enum::block_message_type:
         process_block_message(originating_peer, received_message, message_hash);
         break;
+      case core_message_type_enum::compact_block_message_type:
+        on_compact_block_message(originating_peer, received_message.as<compact_block_message>());
+        break;
+      case core_message_type_enum::get_compact_block_txs_message_type:
+        on_get_compact_block_txs_message(originating_peer, received_message.as<get_compact_block_txs_message>());
+        break;
+      case core_message_type_enum::compact_block_txs_message_type:
+        on_compact_block_txs_message(originating_peer, received_message.as<compact_block_txs_message>());
+        break;
       case core_message_type_enum::current_time_request_message_type:
         on_current_time_request_message(originating_peer, received_message.as<current_time_request_message>());
         break;
@@ -2727,7 +2783,7 @@ namespace graphene { namespace net { namespace detail {
       }
     }
 
-    message node_impl::get_message_for_item(const item_id& item)
+    message_ptr node_impl::get_message_for_item(const item_id& item)
     {
       try
       {
@@ -2737,11 +2793,11 @@ namespace graphene { namespace net { namespace detail {
       {}
       try
       {
-        return _delegate->get_item(item);
+        return std::make_shared<const message>(_delegate->get_item(item));
       }
       catch (fc::key_not_found_exception&)
       {}
-      return item_not_available_message(item);
+      return std::make_shared<const message>(item_not_available_message(item));
     }
 
     void node_impl::on_fetch_items_message(peer_connection* originating_peer, const fetch_items_message& fetch_items_message_received)
@@ -2752,20 +2808,31 @@ namespace graphene { namespace net { namespace detail {
            ("type", fetch_items_message_received.item_type)
            ("endpoint", originating_peer->get_remote_endpoint()));
 
-      fc::optional<message> last_block_message_sent;
+      message_ptr last_block_message_sent;
 
-      std::list<message> reply_messages;
+      // replies from the message cache are shared with it instead of being copied for every peer
+      std::list<message_ptr> reply_messages;
+      std::set<const message*> cached_replies;
       for (const item_hash_t& item_hash : fetch_items_message_received.items_to_fetch)
       {
         try
         {
-          message requested_message = _message_cache.get_message(item_hash);
+          message_ptr requested_message = _message_cache.get_message(item_hash);
           dlog("received item request for item ${id} from peer ${endpoint}, returning the item from my message cache",
                ("endpoint", originating_peer->get_remote_endpoint())
-               ("id", requested_message.id()));
-          reply_messages.push_back(requested_message);
+               ("id", item_hash));
+          if (fetch_items_message_received.item_type == block_message_type &&
+              originating_peer->core_protocol_version >= GRAPHENE_NET_COMPACT_BLOCK_PROTOCOL_VERSION)
+          {
+            // a block still in the message cache was just broadcast, so the peer most likely
+            // has seen nearly all of its transactions already
+            reply_messages.push_back(_message_cache.get_compact_block_message(item_hash));
+          }
+          else
+            reply_messages.push_back(requested_message);
+          cached_replies.insert(reply_messages.back().get());
           if (fetch_items_message_received.item_type == block_message_type)
-            last_block_message_sent = requested_message;
+            last_block_message_sent = reply_messages.back();
           continue;
         }
         catch (fc::key_not_found_exception&)
@@ -2776,10 +2843,10 @@ namespace graphene { namespace net { namespace detail {
         item_id item_to_fetch(fetch_items_message_received.item_type, item_hash);
         try
         {
-          message requested_message = _delegate->get_item(item_to_fetch);
+          message_ptr requested_message = std::make_shared<const message>(_delegate->get_item(item_to_fetch));
           dlog("received item request from peer ${endpoint}, returning the item from delegate with id ${id} size ${size}",
-               ("id", requested_message.id())
-               ("size", requested_message.size)
+               ("id", item_hash)
+               ("size", requested_message->size)
                ("endpoint", originating_peer->get_remote_endpoint()));
           reply_messages.push_back(requested_message);
           if (fetch_items_message_received.item_type == block_message_type)
@@ -2788,7 +2855,7 @@ namespace graphene { namespace net { namespace detail {
         }
         catch (fc::key_not_found_exception&)
         {
-          reply_messages.push_back(item_not_available_message(item_to_fetch));
+          reply_messages.push_back(std::make_shared<const message>(item_not_available_message(item_to_fetch)));
           dlog("received item request from peer ${endpoint} but we don't have it",
                ("endpoint", originating_peer->get_remote_endpoint()));
         }
@@ -2797,24 +2864,179 @@ namespace graphene { namespace net { namespace detail {
       // if we sent them a block, update our record of the last block they've seen accordingly
       if (last_block_message_sent)
       {
-        graphene::net::block_message block = last_block_message_sent->as<graphene::net::block_message>();
-        originating_peer->last_block_delegate_has_seen = block.block_id;
-        originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(block.block_id);
+        block_id_type block_id = last_block_message_sent->msg_type == compact_block_message_type ?
+                                 last_block_message_sent->as<compact_block_message>().block_id :
+                                 last_block_message_sent->as<graphene::net::block_message>().block_id;
+        originating_peer->last_block_delegate_has_seen = block_id;
+        originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(block_id);
       }
 
-      for (const message& reply : reply_messages)
+      for (const message_ptr& reply : reply_messages)
       {
-        if (reply.msg_type == block_message_type)
-          originating_peer->send_item(item_id(block_message_type, reply.as<graphene::net::block_message>().block_id));
+        // blocks we had to get from the delegate aren't held in the send queue, they are
+        // fetched again when it is their turn to be sent
+        if (reply->msg_type == block_message_type && !cached_replies.count(reply.get()))
+          originating_peer->send_item(item_id(block_message_type, reply->as<graphene::net::block_message>().block_id));
         else
           originating_peer->send_message(reply);
       }
     }
 
+    void node_impl::on_compact_block_message(peer_connection* originating_peer, const compact_block_message& compact_block_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      // the peer answers any request for a block still in its message cache with a compact block,
+      // and can't tell our sync requests from the ones made during normal operation
+      const block_id_type& block_id = compact_block_message_received.block_id;
+      bool block_requested = originating_peer->items_requested_from_peer.find(item_id(block_message_type, block_id)) != originating_peer->items_requested_from_peer.end() ||
+                             originating_peer->sync_items_requested_from_peer.find(block_id) != originating_peer->sync_items_requested_from_peer.end();
+      if (!block_requested ||
+          originating_peer->compact_blocks_awaiting_transactions.find(compact_block_message_received.block_id) != originating_peer->compact_blocks_awaiting_transactions.end())
+      {
+        wlog("received a compact block ${block_id} I didn't ask for from peer ${endpoint}, disconnecting from peer",
+             ("endpoint", originating_peer->get_remote_endpoint())
+             ("block_id", compact_block_message_received.block_id));
+        fc::exception detailed_error(FC_LOG_MESSAGE(error, "You sent me a block that I didn't ask for, block_id: ${block_id}",
+                                                    ("block_id", compact_block_message_received.block_id) ));
+        disconnect_from_peer(originating_peer, "You sent me a block that I didn't ask for", true, detailed_error);
+        return;
+      }
+
+      peer_connection::partial_compact_block partial_block;
+      partial_block.block.block_id = compact_block_message_received.block_id;
+      static_cast<sigmaengine::protocol::signed_block_header&>(partial_block.block.block) = compact_block_message_received.header;
+      partial_block.block.block.transactions.resize(compact_block_message_received.short_ids.size());
+      for (uint32_t i = 0; i < compact_block_message_received.short_ids.size(); ++i)
+      {
+        fc::optional<signed_transaction> trx = _message_cache.get_transaction_by_short_id(compact_block_message_received.short_ids[i]);
+        if (trx)
+          partial_block.block.block.transactions[i] = std::move(*trx);
+        else
+          partial_block.missing_indexes.push_back(i);
+      }
+      dlog("received compact block ${block_id} from peer ${endpoint}, missing ${missing} of ${total} transactions",
+           ("block_id", compact_block_message_received.block_id)
+           ("endpoint", originating_peer->get_remote_endpoint())
+           ("missing", partial_block.missing_indexes.size())
+           ("total", compact_block_message_received.short_ids.size()));
+
+      if (partial_block.missing_indexes.empty())
+        process_compact_block(originating_peer, std::move(partial_block));
+      else
+        request_compact_block_transactions(originating_peer, std::move(partial_block));
+    }
+
+    void node_impl::on_get_compact_block_txs_message(peer_connection* originating_peer, const get_compact_block_txs_message& get_compact_block_txs_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      item_id requested_item(block_message_type, get_compact_block_txs_message_received.block_id);
+      graphene::net::block_message requested_block;
+      try
+      {
+        requested_block = _delegate->get_item(requested_item).as<graphene::net::block_message>();
+      }
+      catch (fc::key_not_found_exception&)
+      {
+        dlog("peer ${endpoint} asked for transactions of compact block ${block_id} which we no longer have",
+             ("endpoint", originating_peer->get_remote_endpoint())
+             ("block_id", get_compact_block_txs_message_received.block_id));
+        originating_peer->send_message(item_not_available_message(requested_item));
+        return;
+      }
+
+      compact_block_txs_message reply;
+      reply.block_id = get_compact_block_txs_message_received.block_id;
+      reply.transactions.reserve(get_compact_block_txs_message_received.indexes.size());
+      for (uint32_t index : get_compact_block_txs_message_received.indexes)
+      {
+        if (index >= requested_block.block.transactions.size())
+        {
+          fc::exception detailed_error(FC_LOG_MESSAGE(error, "Transaction index ${index} is out of range for block ${block_id}",
+                                                      ("index", index)("block_id", reply.block_id)));
+          disconnect_from_peer(originating_peer, "You asked for a transaction that isn't in the block", true, detailed_error);
+          return;
+        }
+        reply.transactions.push_back(requested_block.block.transactions[index]);
+      }
+      originating_peer->send_message(reply);
+    }
+
+    void node_impl::on_compact_block_txs_message(peer_connection* originating_peer, const compact_block_txs_message& compact_block_txs_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      auto iter = originating_peer->compact_blocks_awaiting_transactions.find(compact_block_txs_message_received.block_id);
+      if (iter == originating_peer->compact_blocks_awaiting_transactions.end())
+      {
+        fc::exception detailed_error(FC_LOG_MESSAGE(error, "You sent me transactions for block ${block_id} that I didn't ask for",
+                                                    ("block_id", compact_block_txs_message_received.block_id)));
+        disconnect_from_peer(originating_peer, "You sent me transactions that I didn't ask for", true, detailed_error);
+        return;
+      }
+      peer_connection::partial_compact_block partial_block = std::move(iter->second);
+      originating_peer->compact_blocks_awaiting_transactions.erase(iter);
+
+      if (compact_block_txs_message_received.transactions.size() != partial_block.missing_indexes.size())
+      {
+        fc::exception detailed_error(FC_LOG_MESSAGE(error, "Expected ${expected} transactions for block ${block_id}, got ${got}",
+                                                    ("expected", partial_block.missing_indexes.size())
+                                                    ("got", compact_block_txs_message_received.transactions.size())
+                                                    ("block_id", compact_block_txs_message_received.block_id)));
+        disconnect_from_peer(originating_peer, "You sent me the wrong number of transactions", true, detailed_error);
+        return;
+      }
+      for (uint32_t i = 0; i < partial_block.missing_indexes.size(); ++i)
+        partial_block.block.block.transactions[partial_block.missing_indexes[i]] = compact_block_txs_message_received.transactions[i];
+      partial_block.missing_indexes.clear();
+
+      process_compact_block(originating_peer, std::move(partial_block));
+    }
+
+    void node_impl::request_compact_block_transactions(peer_connection* originating_peer, peer_connection::partial_compact_block&& partial_block)
+    {
+      VERIFY_CORRECT_THREAD();
+      get_compact_block_txs_message request;
+      request.block_id = partial_block.block.block_id;
+      request.indexes = partial_block.missing_indexes;
+      originating_peer->compact_blocks_awaiting_transactions[request.block_id] = std::move(partial_block);
+      originating_peer->send_message(request);
+    }
+
+    void node_impl::process_compact_block(peer_connection* originating_peer, peer_connection::partial_compact_block&& partial_block)
+    {
+      VERIFY_CORRECT_THREAD();
+      signed_block& block = partial_block.block.block;
+      if (block.calculate_merkle_root() != block.transaction_merkle_root)
+      {
+        if (!partial_block.requested_all_transactions)
+        {
+          // a short id matched a different transaction in our cache, fall back to fetching all of them
+          wlog("rebuilt compact block ${block_id} from peer ${endpoint} doesn't match its merkle root, requesting all transactions",
+               ("block_id", partial_block.block.block_id)
+               ("endpoint", originating_peer->get_remote_endpoint()));
+          partial_block.requested_all_transactions = true;
+          partial_block.missing_indexes.resize(block.transactions.size());
+          for (uint32_t i = 0; i < partial_block.missing_indexes.size(); ++i)
+            partial_block.missing_indexes[i] = i;
+          request_compact_block_transactions(originating_peer, std::move(partial_block));
+          return;
+        }
+        fc::exception detailed_error(FC_LOG_MESSAGE(error, "Transactions you sent me for block ${block_id} don't match its merkle root",
+                                                    ("block_id", partial_block.block.block_id)));
+        disconnect_from_peer(originating_peer, "You sent me a block that I have deemed to be invalid", true, detailed_error);
+        return;
+      }
+
+      // from here on it is exactly the block_message the peer would have sent us
+      message block_message_to_process(partial_block.block);
+      process_block_message(originating_peer, block_message_to_process, block_message_to_process.id());
+    }
+
     void node_impl::on_item_not_available_message( peer_connection* originating_peer, const item_not_available_message& item_not_available_message_received )
     {
       VERIFY_CORRECT_THREAD();
       const item_id& requested_item = item_not_available_message_received.requested_item;
+      if (requested_item.item_type == block_message_type)
+        originating_peer->compact_blocks_awaiting_transactions.erase(requested_item.item_hash);
       auto regular_item_iter = originating_peer->items_requested_from_peer.find(requested_item);
       if (regular_item_iter != originating_peer->items_requested_from_peer.end())
       {
@@ -3472,7 +3694,7 @@ namespace graphene { namespace net { namespace detail {
           peer->clear_old_inventory();
         }
         message_propagation_data propagation_data{message_receive_time, message_validated_time, originating_peer->node_id};
-        broadcast( block_message_to_process, propagation_data );
+        broadcast( std::make_shared<const message>(block_message_to_process), message_hash, propagation_data );
         _message_cache.block_accepted();
 
         if (is_hard_fork_block(block_number))
@@ -3923,7 +4145,7 @@ namespace graphene { namespace net { namespace detail {
 
         // finally, if the delegate validated the message, broadcast it to our other peers
         message_propagation_data propagation_data{message_receive_time, message_validated_time, originating_peer->node_id};
-        broadcast( message_to_process, propagation_data );
+        broadcast( std::make_shared<const message>(message_to_process), message_hash, propagation_data );
       }
     }
 
@@ -4929,26 +5151,26 @@ namespace graphene { namespace net { namespace detail {
       return (uint32_t)_active_connections.size();
     }
 
-    void node_impl::broadcast( const message& item_to_broadcast, const message_propagation_data& propagation_data )
+    void node_impl::broadcast( const message_ptr& item_to_broadcast, const message_hash_type& hash_of_item_to_broadcast,
+                               const message_propagation_data& propagation_data )
     {
       VERIFY_CORRECT_THREAD();
       fc::uint160_t hash_of_message_contents;
-      if( item_to_broadcast.msg_type == graphene::net::block_message_type )
+      if( item_to_broadcast->msg_type == graphene::net::block_message_type )
       {
-        graphene::net::block_message block_message_to_broadcast = item_to_broadcast.as<graphene::net::block_message>();
+        graphene::net::block_message block_message_to_broadcast = item_to_broadcast->as<graphene::net::block_message>();
         hash_of_message_contents = block_message_to_broadcast.block_id; // for debugging
         _most_recent_blocks_accepted.push_back( block_message_to_broadcast.block_id );
       }
-      else if( item_to_broadcast.msg_type == graphene::net::trx_message_type )
+      else if( item_to_broadcast->msg_type == graphene::net::trx_message_type )
       {
-        graphene::net::trx_message transaction_message_to_broadcast = item_to_broadcast.as<graphene::net::trx_message>();
+        graphene::net::trx_message transaction_message_to_broadcast = item_to_broadcast->as<graphene::net::trx_message>();
         hash_of_message_contents = transaction_message_to_broadcast.trx.id(); // for debugging
         dlog( "broadcasting trx: ${trx}", ("trx", transaction_message_to_broadcast) );
       }
-      message_hash_type hash_of_item_to_broadcast = item_to_broadcast.id();
 
       _message_cache.cache_message( item_to_broadcast, hash_of_item_to_broadcast, propagation_data, hash_of_message_contents );
-      _new_inventory.insert( item_id(item_to_broadcast.msg_type, hash_of_item_to_broadcast ) );
+      _new_inventory.insert( item_id(item_to_broadcast->msg_type, hash_of_item_to_broadcast ) );
       trigger_advertise_inventory_loop();
     }
 
@@ -4957,7 +5179,7 @@ namespace graphene { namespace net { namespace detail {
       VERIFY_CORRECT_THREAD();
       // this version is called directly from the client
       message_propagation_data propagation_data{fc::time_point::now(), fc::time_point::now(), _node_id};
-      broadcast( item_to_broadcast, propagation_data );
+      broadcast( std::make_shared<const message>(item_to_broadcast), item_to_broadcast.id(), propagation_data );
     }
 
     void node_impl::sync_from(const item_id& current_head_block, const std::vector<uint32_t>& hard_fork_block_numbers)
@@ -163,6 +163,55 @@ size_t stcp_socket::writesome( const std::shared_ptr<const char>& buf, size_t le
   return writesome(buf.get() + offset, len);
 }
 
+size_t stcp_socket::write_padded( std::initializer_list< std::pair<const char*, size_t> > buffers )
+{ try {
+#ifndef NDEBUG
+    struct check_buffer_in_use {
+      bool& _buffer_in_use;
+      check_buffer_in_use(bool& buffer_in_use) : _buffer_in_use(buffer_in_use) { assert(!_buffer_in_use); _buffer_in_use = true; }
+      ~check_buffer_in_use() { assert(_buffer_in_use); _buffer_in_use = false; }
+    } buffer_in_use_checker(_write_buffer_in_use);
+#endif
+
+    const std::size_t write_buffer_length = 4096;
+    if (!_write_buffer)
+      _write_buffer.reset(new char[write_buffer_length], [](char* p){ delete[] p; });
+    if (!_plaintext_buffer)
+      _plaintext_buffer.reset(new char[write_buffer_length]);
+
+    size_t total_written = 0;
+    size_t staged = 0;
+    auto encrypt_and_write_staged = [&]()
+    {
+      uint32_t ciphertext_len = _send_aes.encode( _plaintext_buffer.get(), staged, _write_buffer.get() );
+      assert(ciphertext_len == staged);
+      _sock.write( _write_buffer, ciphertext_len );
+      total_written += ciphertext_len;
+      staged = 0;
+    };
+
+    for (const auto& buffer : buffers)
+    {
+      size_t offset = 0;
+      while (offset < buffer.second)
+      {
+        size_t bytes_to_stage = std::min<size_t>(write_buffer_length - staged, buffer.second - offset);
+        memcpy(_plaintext_buffer.get() + staged, buffer.first + offset, bytes_to_stage);
+        staged += bytes_to_stage;
+        offset += bytes_to_stage;
+        if (staged == write_buffer_length)
+          encrypt_and_write_staged();
+      }
+    }
+
+    size_t staged_with_padding = 16 * ((staged + 15) / 16);
+    memset(_plaintext_buffer.get() + staged, 0, staged_with_padding - staged);
+    staged = staged_with_padding;
+    if (staged)
+      encrypt_and_write_staged();
+    return total_written;
+} FC_RETHROW_EXCEPTIONS( warn, "" ) }
+
 void stcp_socket::flush()
 {
   _sock.flush();
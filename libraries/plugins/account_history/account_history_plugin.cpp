@@ -51,66 +51,76 @@ account_history_plugin_impl::~account_history_plugin_impl()
 
 struct operation_visitor
 {
-   operation_visitor( database& db, const operation_notification& note, const operation_object*& n, account_name_type i )
-      :_db(db), _note(note), new_obj(n), item(i) {}
+   operation_visitor( database& db, const operation_notification& note, account_name_type i )
+      :_db(db), _note(note), item(i) {}
 
    typedef void result_type;
 
    database& _db;
    const operation_notification& _note;
-   const operation_object*& new_obj;
    account_name_type item;
 
    template<typename Op>
    void operator()( Op&& )const
    {
-         const auto& hist_idx = _db.get_index<account_history_index>().indices().get<by_account>();
-         if( !new_obj )
+         const auto& new_obj = _db.get_operation_object( _note );
+         uint32_t op_tag = _note.op.which();
+
+         // the sequences of accounts which have history from before the sequence objects existed
+         // and of op tags new to the account are taken from the history once
+         const auto* seq_obj = _db.find< account_history_sequence_object, by_account >( item );
+         if( !seq_obj )
          {
-            new_obj = &_db.create<operation_object>( [&]( operation_object& obj )
+            const auto& hist_idx = _db.get_index<account_history_index>().indices().get<by_account>();
+            auto hist_itr = hist_idx.lower_bound( boost::make_tuple( item, uint32_t(-1) ) );
+
+            seq_obj = &_db.create< account_history_sequence_object >( [&]( account_history_sequence_object& seq )
             {
-               obj.trx_id       = _note.trx_id;
-               obj.block        = _note.block;
-               obj.trx_in_block = _note.trx_in_block;
-               obj.op_in_trx    = _note.op_in_trx;
-               obj.virtual_op   = _note.virtual_op;
-               obj.timestamp    = _db.head_block_time();
-               //fc::raw::pack( obj.serialized_op , _note.op);  //call to 'pack' is ambiguous
-               auto size = fc::raw::pack_size( _note.op );
-               obj.serialized_op.resize( size );
-               fc::datastream< char* > ds( obj.serialized_op.data(), size );
-               fc::raw::pack( ds, _note.op );
+               seq.account = item;
+               if( hist_itr != hist_idx.end() && hist_itr->account == item )
+                  seq.next_sequence = hist_itr->sequence + 1;
             });
          }
 
-         auto hist_itr = hist_idx.lower_bound( boost::make_tuple( item, uint32_t(-1) ) );
-         uint32_t sequence = 0;
-         if( hist_itr != hist_idx.end() && hist_itr->account == item )
-            sequence = hist_itr->sequence + 1;
-
-
+         uint32_t sequence = seq_obj->next_sequence;
          uint32_t op_seq = 0;
-         const auto& hiop_idx = _db.get_index<account_history_index>().indices().get<by_op_tag>();
-         auto hiop_itr = hiop_idx.lower_bound( boost::make_tuple( item, _note.op.which(), uint32_t(-1) ) );
-         if( hiop_itr != hiop_idx.end() && hiop_itr->account == item )
-            op_seq = hiop_itr->op_seq + 1;
+         auto op_seq_itr = seq_obj->next_op_seq.find( op_tag );
+         if( op_seq_itr != seq_obj->next_op_seq.end() )
+         {
+            op_seq = op_seq_itr->second;
+         }
+         else if( sequence )
+         {
+            // a tag new to the account continues the op_seq of the next entry by_op_tag finds, as
+            // before, so existing and replayed nodes number history identically
+            const auto& hiop_idx = _db.get_index<account_history_index>().indices().get<by_op_tag>();
+            auto hiop_itr = hiop_idx.lower_bound( boost::make_tuple( item, op_tag, uint32_t(-1) ) );
+            if( hiop_itr != hiop_idx.end() && hiop_itr->account == item )
+               op_seq = hiop_itr->op_seq + 1;
+         }
+
+         _db.modify( *seq_obj, [&]( account_history_sequence_object& seq )
+         {
+            seq.next_sequence = sequence + 1;
+            seq.next_op_seq[ op_tag ] = op_seq + 1;
+         });
 
          _db.create<account_history_object>( [&]( account_history_object& ahist )
          {
             ahist.account  = item;
             ahist.sequence = sequence;
-            ahist.op_tag = _note.op.which();
+            ahist.op_tag = op_tag;
             ahist.op_seq = op_seq;
             
-            ahist.op       = new_obj->id;
+            ahist.op       = new_obj.id;
          });
    }
 };
 
 struct operation_visitor_filter : operation_visitor
 {
-   operation_visitor_filter( database& db, const operation_notification& note, const operation_object*& n, account_name_type i, const flat_set< string >& filter, bool blacklist ):
-      operation_visitor( db, note, n, i ), _filter( filter ), _blacklist( blacklist ) {}
+   operation_visitor_filter( database& db, const operation_notification& note, account_name_type i, const flat_set< string >& filter, bool blacklist ):
+      operation_visitor( db, note, i ), _filter( filter ), _blacklist( blacklist ) {}
 
    const flat_set< string >& _filter;
    bool _blacklist;
@@ -136,7 +146,6 @@ void account_history_plugin_impl::on_operation( const operation_notification& no
    flat_set<account_name_type> impacted;
    sigmaengine::chain::database& db = database();
 
-   const operation_object* new_obj = nullptr;
    app::operation_get_impacted_accounts( note.op, db, impacted );
 
    for( const auto& item : impacted ) {
@@ -171,11 +180,11 @@ void account_history_plugin_impl::on_operation( const operation_notification& no
       {
          if(_filter_content)
          {
-            note.op.visit( operation_visitor_filter( db, note, new_obj, item, _op_list, _blacklist ) );
+            note.op.visit( operation_visitor_filter( db, note, item, _op_list, _blacklist ) );
          }
          else
          {
-            note.op.visit( operation_visitor( db, note, new_obj, item ) );
+            note.op.visit( operation_visitor( db, note, item ) );
          }
       }
    }
@@ -1,6 +1,5 @@
 
 #include <sigmaengine/chain/database.hpp>
-#include <sigmaengine/chain/global_property_object.hpp>
 
 #include <sigmaengine/plugins/block_info/block_info.hpp>
 #include <sigmaengine/plugins/block_info/block_info_api.hpp>
@@ -22,7 +21,8 @@ void block_info_plugin::plugin_initialize( const boost::program_options::variabl
 {
    chain::database& db = database();
 
-   _applied_block_conn  = db.applied_block.connect([this](const chain::signed_block& b){ on_applied_block(b); });
+   // the block size is computed off the write thread from the event alone, the handler never reads the database
+   _applied_block_subscription = db.subscribe_applied_blocks( "block_info", [this]( const chain::applied_block_event& e ){ on_applied_block( e ); } );
 }
 
 void block_info_plugin::plugin_startup()
@@ -32,23 +32,24 @@ void block_info_plugin::plugin_startup()
 
 void block_info_plugin::plugin_shutdown()
 {
+   if( _applied_block_subscription )
+      _applied_block_subscription->stop();
 }
 
-void block_info_plugin::on_applied_block( const chain::signed_block& b )
+void block_info_plugin::on_applied_block( const chain::applied_block_event& e )
 {
-   uint32_t block_num = b.block_num();
-   const chain::database& db = database();
+   uint32_t block_size = fc::raw::pack_size( *e.block );
 
-   while( block_num >= _block_info.size() )
+   std::lock_guard< std::mutex > lock( _block_info_mutex );
+   while( e.block_num >= _block_info.size() )
       _block_info.emplace_back();
 
-   block_info& info = _block_info[block_num];
-   const chain::dynamic_global_property_object& dgpo = db.get_dynamic_global_properties();
+   block_info& info = _block_info[e.block_num];
 
-   info.block_id                    = b.id();
-   info.block_size                  = fc::raw::pack_size( b );
-   info.aslot                       = dgpo.current_aslot;
-   info.last_irreversible_block_num = dgpo.last_irreversible_block_num;
+   info.block_id                    = e.block_id;
+   info.block_size                  = block_size;
+   info.aslot                       = e.aslot;
+   info.last_irreversible_block_num = e.last_irreversible_block_num;
    return;
 }
 
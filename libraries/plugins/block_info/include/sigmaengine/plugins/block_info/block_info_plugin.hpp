@@ -2,15 +2,13 @@
 #pragma once
 
 #include <sigmaengine/app/plugin.hpp>
+#include <sigmaengine/chain/event_bus.hpp>
 #include <sigmaengine/plugins/block_info/block_info.hpp>
 
+#include <mutex>
 #include <string>
 #include <vector>
 
-namespace sigmaengine { namespace protocol {
-struct signed_block;
-} }
-
 namespace sigmaengine { namespace plugin { namespace block_info {
 
 using sigmaengine::app::application;
@@ -26,11 +24,12 @@ class block_info_plugin : public sigmaengine::app::plugin
       virtual void plugin_startup() override;
       virtual void plugin_shutdown() override;
 
-      void on_applied_block( const chain::signed_block& b );
+      void on_applied_block( const chain::applied_block_event& e );
 
       std::vector< block_info > _block_info;
+      std::mutex                _block_info_mutex;   ///< blocks are recorded on the subscriber thread
 
-      boost::signals2::scoped_connection _applied_block_conn;
+      std::shared_ptr< chain::applied_block_subscriber > _applied_block_subscription;
 };
 
 } } }
@@ -1,4 +1,5 @@
 #include <sigmaengine/dapp/dapp_api.hpp>
+#include <sigmaengine/dapp/dapp_plugin.hpp>
 #include <sigmaengine/app/state.hpp>
 
 #include <functional>
@@ -39,6 +40,11 @@ namespace sigmaengine { namespace dapp {
 
             sigmaengine::chain::database& database() { return *_app.chain_database(); }
 
+            const dapp_content_store& content_store()const
+            {
+               return _app.get_plugin< dapp_plugin >( DAPP_PLUGIN_NAME )->content_store();
+            }
+
          private:
             static bool filter_default( const dapp_comment_api_obj& c ) { return false; }
             static bool exit_default( const dapp_comment_api_obj& c )   { return false; }
@@ -93,7 +99,7 @@ namespace sigmaengine { namespace dapp {
             auto itr = by_permlink_idx.find( boost::make_tuple( dapp_name, author, permlink ) );
             if( itr != by_permlink_idx.end() )
             {
-               optional< dapp_discussion > result( *itr);
+               optional< dapp_discussion > result( dapp_discussion( *itr, content_store() ) );
                result->like_votes = get_dapp_active_votes( dapp_name, author, permlink, comment_vote_type::LIKE );
                result->dislike_votes = get_dapp_active_votes( dapp_name, author, permlink, comment_vote_type::DISLIKE );
                return result;
@@ -113,7 +119,7 @@ namespace sigmaengine { namespace dapp {
             vector<dapp_discussion> result;
             while( itr != by_permlink_idx.end() && itr->dapp_name == dapp_name && itr->parent_author == author && to_string( itr->parent_permlink ) == permlink )
             {
-               result.push_back( dapp_discussion( *itr ) );
+               result.push_back( dapp_discussion( *itr, content_store() ) );
                ++itr;
             }
             return result;
@@ -126,17 +132,13 @@ namespace sigmaengine { namespace dapp {
          auto& _db = *(_app.chain_database());
          // const auto& dapp_comment_idx = _app.chain_database()->get_index< dapp_comment_index >().indices().get< by_id >();
          // dapp_discussion d = dapp_comment_idx.get(id);
-         dapp_discussion d = _db.get(id);
+         // only the first truncate_body bytes of the body are read
+         dapp_discussion d( _db.get(id), content_store(), truncate_body );
 
          d.like_votes = get_dapp_active_votes( d.dapp_name, d.author, d.permlink, comment_vote_type::LIKE );
          d.dislike_votes = get_dapp_active_votes( d.dapp_name, d.author, d.permlink, comment_vote_type::DISLIKE );
-         d.body_length = d.body.size();
-         if( truncate_body ) {
-            d.body = d.body.substr( 0, truncate_body );
-
-            if( !fc::is_utf8( d.body ) )
-               d.body = fc::prune_invalid_utf8( d.body );
-         }
+         if( truncate_body && !fc::is_utf8( d.body ) )
+            d.body = fc::prune_invalid_utf8( d.body );
          return d;
       }
 
@@ -275,7 +277,7 @@ namespace sigmaengine { namespace dapp {
 
                if( itr->parent_author.size() == 0 )
                {
-                  result.emplace_back( *itr );
+                  result.emplace_back( *itr, content_store() );
                   result.back().like_votes = get_dapp_active_votes( dapp_name, itr->author, to_string( itr->permlink ), comment_vote_type::LIKE );
                   result.back().dislike_votes = get_dapp_active_votes( dapp_name, itr->author, to_string( itr->permlink ), comment_vote_type::DISLIKE );
                   ++count;
@@ -317,7 +319,7 @@ namespace sigmaengine { namespace dapp {
 
             while( itr != last_update_idx.end() && result.size() < limit && itr->parent_author == *parent_author )
             {
-               result.emplace_back( *itr );
+               result.emplace_back( *itr, content_store() );
                result.back().like_votes = get_dapp_active_votes( dapp_name, itr->author, to_string( itr->permlink ), comment_vote_type::LIKE );
                result.back().dislike_votes = get_dapp_active_votes( dapp_name, itr->author, to_string( itr->permlink ), comment_vote_type::DISLIKE );
                ++itr;
@@ -0,0 +1,235 @@
+#include <sigmaengine/dapp/dapp_content_store.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/log/logger.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define STORE_READ  (std::ios::in | std::ios::binary)
+#define STORE_WRITE (std::ios::out | std::ios::binary | std::ios::app)
+
+namespace sigmaengine { namespace dapp {
+
+   namespace detail {
+      static const uint64_t header_size = sizeof( uint32_t ) + sizeof( fc::ripemd160 );
+
+      class dapp_content_store_impl
+      {
+         public:
+            fc::path                                        file;
+            bool                                            opened = false;
+            bool                                            read_only = false;
+            std::ofstream                                   write_stream;
+            std::ifstream                                   read_stream;
+            std::mutex                                      read_mutex;   ///< APIs read from several threads
+            uint64_t                                        end = 0;
+            std::unordered_map< fc::ripemd160, uint64_t >   offsets;      ///< content position by hash, only when writing
+            int                                             sync_fd = -1;
+            bool                                            unsynced = false;   ///< appended since the last sync
+
+            void load();
+            void append( const dapp_content_ref& ref, const std::string& content );
+      };
+
+      void dapp_content_store_impl::load()
+      {
+         uint64_t file_end = fc::file_size( file );
+         std::ifstream in( file.generic_string().c_str(), STORE_READ );
+
+         uint64_t pos = 0;
+         char header[ header_size ];
+         while( pos + header_size <= file_end )
+         {
+            in.seekg( pos );
+            in.read( header, header_size );
+
+            uint32_t size;
+            memcpy( &size, header, sizeof( size ) );
+            if( pos + header_size + size > file_end )
+               break;
+
+            fc::ripemd160 hash;
+            memcpy( hash.data(), header + sizeof( size ), sizeof( hash ) );
+            offsets.emplace( hash, pos + header_size );
+            pos += header_size + size;
+         }
+
+         if( pos < file_end )
+         {
+            wlog( "Removing an incomplete record of ${n} bytes from the end of ${f}", ("n", file_end - pos)("f", file) );
+            in.close();
+            fc::resize_file( file, pos );
+         }
+         end = pos;
+      }
+
+      void dapp_content_store_impl::append( const dapp_content_ref& ref, const std::string& content )
+      {
+         try
+         {
+            write_stream.write( (const char*)&ref.size, sizeof( ref.size ) );
+            write_stream.write( ref.hash.data(), sizeof( ref.hash ) );
+            write_stream.write( content.data(), content.size() );
+            // readers open the file separately, they have to see it before the comment referencing it is applied
+            write_stream.flush();
+            unsynced = true;
+         }
+         catch( ... )
+         {
+            // the next record would follow a partial one, cut it off and start from the last complete record
+            write_stream.clear();
+            try { write_stream.close(); } catch( ... ) {}
+            write_stream.clear();
+            fc::resize_file( file, end );
+            write_stream.open( file.generic_string().c_str(), STORE_WRITE );
+            throw;
+         }
+      }
+   }
+
+   dapp_content_store::dapp_content_store()
+   :my( new detail::dapp_content_store_impl() )
+   {
+      my->write_stream.exceptions( std::ofstream::failbit | std::ofstream::badbit );
+   }
+
+   dapp_content_store::~dapp_content_store()
+   {
+      close();
+   }
+
+   void dapp_content_store::open( const fc::path& file, bool read_only )
+   {
+      try
+      {
+         close();
+
+         my->file = file;
+         my->opened = true;
+         my->read_only = read_only;
+         if( read_only )
+            return;
+
+         if( !fc::exists( file ) )
+         {
+            fc::create_directories( file.parent_path() );
+            std::ofstream( file.generic_string().c_str(), STORE_WRITE );
+         }
+
+         my->load();
+         my->write_stream.open( file.generic_string().c_str(), STORE_WRITE );
+         ilog( "Opened dapp content store ${f} with ${n} texts", ("f", file)("n", my->offsets.size()) );
+      }
+      FC_CAPTURE_AND_RETHROW( (file)(read_only) )
+   }
+
+   void dapp_content_store::close()
+   {
+      if( my->write_stream.is_open() )
+         my->write_stream.close();
+#ifndef WIN32
+      if( my->sync_fd >= 0 )
+         ::close( my->sync_fd );
+#endif
+      my->sync_fd = -1;
+      my->unsynced = false;
+
+      std::lock_guard< std::mutex > lock( my->read_mutex );
+      if( my->read_stream.is_open() )
+         my->read_stream.close();
+
+      my->opened = false;
+      my->end = 0;
+      my->offsets.clear();
+   }
+
+   bool dapp_content_store::is_open()const
+   {
+      return my->opened;
+   }
+
+   dapp_content_ref dapp_content_store::store( const std::string& content )
+   {
+      try
+      {
+         dapp_content_ref ref;
+         if( content.empty() )
+            return ref;
+
+         FC_ASSERT( my->write_stream.is_open(), "Dapp content store is not open for writing" );
+         FC_ASSERT( content.size() <= std::numeric_limits< uint32_t >::max() );
+
+         ref.hash = fc::ripemd160::hash( content );
+         ref.size = content.size();
+
+         auto itr = my->offsets.find( ref.hash );
+         if( itr != my->offsets.end() )
+         {
+            ref.offset = itr->second;
+            return ref;
+         }
+
+         my->append( ref, content );
+
+         ref.offset = my->end + detail::header_size;
+         my->end = ref.offset + ref.size;
+         my->offsets.emplace( ref.hash, ref.offset );
+         return ref;
+      }
+      FC_CAPTURE_AND_RETHROW( (content.size()) )
+   }
+
+   bool dapp_content_store::sync()
+   {
+      if( !my->unsynced )
+         return true;
+
+#ifndef WIN32
+      if( my->sync_fd < 0 )
+         my->sync_fd = ::open( my->file.generic_string().c_str(), O_RDONLY );
+      if( my->sync_fd < 0 || ::fsync( my->sync_fd ) != 0 )
+      {
+         elog( "Could not sync ${f}: ${e}", ("f", my->file)("e", strerror( errno )) );
+         return false;
+      }
+#endif
+      my->unsynced = false;
+      return true;
+   }
+
+   std::string dapp_content_store::read( const dapp_content_ref& ref, uint32_t max_size )const
+   {
+      try
+      {
+         if( ref.empty() )
+            return std::string();
+
+         uint32_t size = max_size ? std::min( max_size, ref.size ) : ref.size;
+         std::string result( size, '\0' );
+
+         std::lock_guard< std::mutex > lock( my->read_mutex );
+         FC_ASSERT( is_open(), "Dapp content store is not open" );
+         if( !my->read_stream.is_open() )
+            my->read_stream.open( my->file.generic_string().c_str(), STORE_READ );
+
+         // the writer may have appended past the end this stream has seen
+         my->read_stream.clear();
+         my->read_stream.seekg( ref.offset );
+         my->read_stream.read( &result[0], size );
+         FC_ASSERT( uint64_t( my->read_stream.gcount() ) == size, "Content is past the end of the dapp content store" );
+         return result;
+      }
+      FC_CAPTURE_AND_RETHROW( (ref.offset)(ref.size)(max_size) )
+   }
+
+} } // sigmaengine::dapp
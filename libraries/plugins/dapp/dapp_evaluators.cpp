@@ -4,26 +4,12 @@
 #include <sigmaengine/chain/account_object.hpp>
 
 #ifndef IS_LOW_MEM
-#include <diff_match_patch.h>
-#include <boost/locale/encoding_utf.hpp>
-
-using boost::locale::conv::utf_to_utf;
-
+#include <sigmaengine/dapp/utf8_patch.hpp>
 #endif
 
 
 namespace sigmaengine { namespace dapp {
 
-   std::wstring utf8_to_wstring(const std::string& str)
-   {
-      return utf_to_utf<wchar_t>(str.c_str(), str.c_str() + str.size());
-   }
-
-   std::string wstring_to_utf8(const std::wstring& str)
-   {
-      return utf_to_utf<char>(str.c_str(), str.c_str() + str.size());
-   }
-
    void create_dapp_evaluator::do_apply( const create_dapp_operation& op )
    {
       try 
@@ -200,10 +186,10 @@ namespace sigmaengine { namespace dapp {
                from_string( com.title, op.title );
                if ( op.body.size() < 1024 * 1024 * 128 )
                {
-                  from_string( com.body, op.body );
+                  com.body = _plugin->content_store().store( op.body );
                }
                if ( fc::is_utf8( op.json_metadata ) )
-                  from_string( com.json_metadata, op.json_metadata );
+                  com.json_metadata = _plugin->content_store().store( op.json_metadata );
                else
                   wlog( "Comment ${a}/${p} contains invalid UTF-8 metadata", ( "a", op.author )( "p", op.permlink ) );
 #endif
@@ -256,31 +242,32 @@ namespace sigmaengine { namespace dapp {
                if ( op.json_metadata.size() )
                {
                   if ( fc::is_utf8( op.json_metadata ) )
-                     from_string( com.json_metadata, op.json_metadata );
+                     com.json_metadata = _plugin->content_store().store( op.json_metadata );
                   else
                      wlog("Comment ${a}/${p} contains invalid UTF-8 metadata", ("a", op.author)("p", op.permlink));
                }
 
                if ( op.body.size() ) {
+                  auto& content = _plugin->content_store();
+                  // a body the store cannot read or write fails the operation, it must not turn an edit into a replace
+                  std::string body = content.read( com.body );
+                  std::string patched_body;
+                  bool patched = false;
                   try {
-                     diff_match_patch<std::wstring> dmp;
-                     auto patch = dmp.patch_fromText( utf8_to_wstring( op.body ) );
-                     if ( patch.size() ) {
-                        auto result = dmp.patch_apply( patch, utf8_to_wstring( to_string( com.body ) ) );
-                        auto patched_body = wstring_to_utf8( result.first );
-                        if ( !fc::is_utf8(patched_body ) ) {
-                           idump( ( "invalid utf8" )( patched_body ) );
-                           from_string( com.body, fc::prune_invalid_utf8( patched_body ) );
-                        }
-                        else { from_string(com.body, patched_body); }
-                     }
-                     else { // replace
-                        from_string( com.body, op.body );
-                     }
+                     patched = apply_utf8_patch( op.body, body, patched_body );
                   }
                   catch (...) {
-                     from_string( com.body, op.body );
+                     // op.body is no patch, it replaces the body
+                  }
+
+                  if ( !patched ) {
+                     com.body = content.store( op.body );
+                  }
+                  else if ( !fc::is_utf8(patched_body ) ) {
+                     idump( ( "invalid utf8" )( patched_body ) );
+                     com.body = content.store( fc::prune_invalid_utf8( patched_body ) );
                   }
+                  else { com.body = content.store( patched_body ); }
                }
 #endif
             });
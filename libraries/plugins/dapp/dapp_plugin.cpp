@@ -3,6 +3,7 @@
 
 #include <sigmaengine/protocol/hardfork.hpp>
 
+#include <sigmaengine/chain/database_exceptions.hpp>
 #include <sigmaengine/chain/generic_custom_operation_interpreter.hpp>
 #include <sigmaengine/chain/index.hpp>
 
@@ -31,6 +32,9 @@ namespace sigmaengine { namespace dapp {
 
             dapp_plugin&  _self;
             std::shared_ptr< generic_custom_operation_interpreter< sigmaengine::dapp::dapp_operation > > _custom_op_interpreter;
+
+         public:
+            dapp_content_store   _content_store;
       };
 
       void dapp_plugin_impl::plugin_initialize() 
@@ -215,6 +219,9 @@ namespace sigmaengine { namespace dapp {
 
          _my->plugin_initialize();
 
+         // next to the shared memory file, whose comments reference it
+         _my->_content_store.open( app().shared_dir() / "dapp_content", options.count( "read-only" ) > 0 );
+
          chain::database& db = database();
          add_plugin_index < dapp_index > ( db );
          add_plugin_index < dapp_comment_index > ( db );
@@ -228,6 +235,9 @@ namespace sigmaengine { namespace dapp {
          });
 
          db.applied_block.connect( [&]( const signed_block& b ){ 
+            // the block's comments reference what it stored, it is committed once the block is applied
+            SIGMAENGINE_ASSERT( _my->_content_store.sync(), chain::plugin_exception,
+               "Could not sync the dapp content store of block ${n}", ("n", b.block_num()) );
             _my->on_apply_block( b ); 
          });
 
@@ -239,6 +249,11 @@ namespace sigmaengine { namespace dapp {
       app().register_api_factory< dapp_api >( "dapp_api" );
    }
 
+   dapp_content_store& dapp_plugin::content_store()
+   {
+      return _my->_content_store;
+   }
+
 } } //namespace sigmaengine::dapp
 
 SIGMAENGINE_DEFINE_PLUGIN( dapp, sigmaengine::dapp::dapp_plugin )
@@ -52,7 +52,8 @@ namespace sigmaengine { namespace dapp {
 
    struct dapp_comment_api_obj
    {
-      dapp_comment_api_obj( const dapp_comment_object& o ):
+      /// truncate_body is the number of bytes of the body to read from the content store, 0 for all
+      dapp_comment_api_obj( const dapp_comment_object& o, const dapp_content_store& content, uint32_t truncate_body = 0 ):
          id( o.id ),
          dapp_name( o.dapp_name ),
          category( to_string( o.category ) ),
@@ -61,8 +62,8 @@ namespace sigmaengine { namespace dapp {
          author( o.author ),
          permlink( to_string( o.permlink ) ),
          title( to_string( o.title ) ),
-         body( to_string( o.body ) ),
-         json_metadata( to_string( o.json_metadata ) ),
+         body( content.read( o.body, truncate_body ) ),
+         json_metadata( content.read( o.json_metadata ) ),
          last_update( o.last_update ),
          created( o.created ),
          active( o.active ),
@@ -139,7 +140,8 @@ namespace sigmaengine { namespace dapp {
    };
 
    struct  dapp_discussion : public dapp_comment_api_obj {
-      dapp_discussion( const dapp_comment_object& o ):dapp_comment_api_obj(o){}
+      dapp_discussion( const dapp_comment_object& o, const dapp_content_store& content, uint32_t truncate_body = 0 )
+         :dapp_comment_api_obj( o, content, truncate_body ), body_length( o.body.size ){}
       dapp_discussion(){}
 
       string                           root_title;
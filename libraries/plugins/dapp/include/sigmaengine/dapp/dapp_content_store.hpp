@@ -0,0 +1,69 @@
+#pragma once
+
+#include <fc/crypto/ripemd160.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/reflect/reflect.hpp>
+
+#include <memory>
+#include <string>
+
+namespace sigmaengine { namespace dapp {
+
+   /**
+    *  Where a text lives in the dapp_content_store.  Objects in the shared memory file hold this
+    *  instead of the text, so editing or undoing a comment only copies these few bytes.
+    */
+   struct dapp_content_ref
+   {
+      fc::ripemd160     hash;
+      uint32_t          size = 0;
+      uint64_t          offset = 0;   ///< position of the text in the store file
+
+      bool empty()const { return size == 0; }
+   };
+
+   namespace detail { class dapp_content_store_impl; }
+
+   /* The dapp content store is an append only file of the bodies and metadata of dapp comments,
+    * each stored once by its hash.
+    *
+    * +------+------+---------+------+------+---------+-----+
+    * | Size | Hash | Content | Size | Hash | Content | ... |
+    * +------+------+---------+------+------+---------+-----+
+    *
+    * Size is 4 bytes and Hash the 20 byte ripemd160 of the content.  Nothing is ever overwritten,
+    * so a reference stays readable after the object holding it is modified, undone or removed.
+    * Content stored again, edits reverted to an earlier version or a replay of the chain, is found
+    * by its hash and not appended twice.  The hashes are loaded from the file when it is opened,
+    * an incomplete record at its end is cut off.  Records are only on disk once sync() returned,
+    * the dapp plugin syncs each applied block's records before its revision is committed.
+    *
+    * The file lives next to the shared memory file, read only nodes read it while the node writing
+    * blocks appends to it.
+    */
+   class dapp_content_store
+   {
+      public:
+         dapp_content_store();
+         ~dapp_content_store();
+
+         void open( const fc::path& file, bool read_only = false );
+         void close();
+         bool is_open()const;
+
+         /// appends content unless the store holds it already, empty content is not stored
+         dapp_content_ref store( const std::string& content );
+
+         /// blocks until the content stored so far is on disk, false if the file could not be synced
+         bool sync();
+
+         /// the first max_size bytes of the referenced content, all of it if max_size is 0
+         std::string read( const dapp_content_ref& ref, uint32_t max_size = 0 )const;
+
+      private:
+         std::unique_ptr< detail::dapp_content_store_impl > my;
+   };
+
+} } // sigmaengine::dapp
+
+FC_REFLECT( sigmaengine::dapp::dapp_content_ref, (hash)(size)(offset) )
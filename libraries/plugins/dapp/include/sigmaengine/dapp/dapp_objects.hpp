@@ -2,6 +2,7 @@
 
 #include <sigmaengine/app/plugin.hpp>
 #include <sigmaengine/chain/sigmaengine_object_types.hpp>
+#include <sigmaengine/dapp/dapp_content_store.hpp>
 
 #include <boost/multi_index/composite_key.hpp>
 
@@ -80,7 +81,7 @@ namespace sigmaengine { namespace dapp {
    public:
       template< typename Constructor, typename Allocator >
       dapp_comment_object(Constructor&& c, allocator< Allocator > a)
-         :category(a), parent_permlink(a), permlink(a), title(a), body(a), json_metadata(a) //, beneficiaries(a)
+         :category(a), parent_permlink(a), permlink(a), title(a) //, beneficiaries(a)
       {
          c(*this);
       }
@@ -95,8 +96,8 @@ namespace sigmaengine { namespace dapp {
       shared_string     permlink;
 
       shared_string     title;
-      shared_string     body;
-      shared_string     json_metadata;
+      dapp_content_ref  body;            ///< in the dapp_content_store, like json_metadata
+      dapp_content_ref  json_metadata;
       time_point_sec    last_update;
       time_point_sec    created;
       time_point_sec    active; ///< the last time this post was "touched" by voting or reply
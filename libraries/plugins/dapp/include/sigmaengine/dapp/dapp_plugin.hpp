@@ -10,6 +10,8 @@ namespace sigmaengine { namespace dapp {
 
    namespace detail { class dapp_plugin_impl; }
 
+   class dapp_content_store;
+
    class dapp_plugin : public sigmaengine::app::plugin
    {
       public:
@@ -19,6 +21,9 @@ namespace sigmaengine { namespace dapp {
          virtual void plugin_initialize( const boost::program_options::variables_map& options ) override;
          virtual void plugin_startup() override;
 
+         /// bodies and metadata of dapp comments
+         dapp_content_store& content_store();
+
          friend class detail::dapp_plugin_impl;
          
       private:
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+
+namespace sigmaengine { namespace dapp {
+
+   /**
+    *  Applies a patch in diff-match-patch text format (patch_toText) to UTF-8 text and stores the
+    *  patched UTF-8 text in result.
+    *
+    *  The result is the same as converting both to std::wstring, applying the patch with
+    *  diff_match_patch<std::wstring>::patch_apply and converting back, which is how comment edits
+    *  were applied before, but the text is matched and edited as UTF-8 in place.  Only the patch
+    *  and the few characters around a patch which does not match exactly are converted.  Fuzzy
+    *  matching only looks at the characters within Match_Distance * Match_Threshold of the
+    *  expected location.
+    *
+    *  Returns false or throws if patch_text is not a patch, callers replace the text in both
+    *  cases.  Text which is not valid UTF-8 is patched by apply_wstring_patch().
+    */
+   bool apply_utf8_patch( const std::string& patch_text, const std::string& text, std::string& result );
+
+   /// reference implementation through std::wstring, same contract as apply_utf8_patch()
+   bool apply_wstring_patch( const std::string& patch_text, const std::string& text, std::string& result );
+
+} } // sigmaengine::dapp
@@ -0,0 +1,612 @@
+#include <sigmaengine/dapp/utf8_patch.hpp>
+
+#include <diff_match_patch.h>
+#include <boost/locale/encoding_utf.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+namespace sigmaengine { namespace dapp {
+
+namespace {
+
+   typedef diff_match_patch< std::wstring > dmp_type;
+
+   std::wstring utf8_to_wstring( const std::string& str )
+   {
+      return boost::locale::conv::utf_to_utf< wchar_t >( str.c_str(), str.c_str() + str.size() );
+   }
+
+   std::string wstring_to_utf8( const std::wstring& str )
+   {
+      return boost::locale::conv::utf_to_utf< char >( str.c_str(), str.c_str() + str.size() );
+   }
+
+   /**
+    *  False if patch_fromText would find no patch or throw because the first line is no patch
+    *  header.  A non-ASCII first character is left to the parser, utf_to_utf may drop it.
+    */
+   bool may_start_with_patch_header( const std::string& str )
+   {
+      auto first = str.find_first_not_of( '\n' );
+      return first != std::string::npos && ( str[ first ] == '@' || ( str[ first ] & 0x80 ) );
+   }
+
+   /// true if the eight bytes at p are all ASCII, most comment text is
+   inline bool is_ascii8( const char* p )
+   {
+      uint64_t word;
+      memcpy( &word, p, sizeof( word ) );
+      return ( word & 0x8080808080808080ull ) == 0;
+   }
+
+   /// number of characters if str is UTF-8 that utf_to_utf converts without skipping anything, -1 otherwise
+   int64_t count_characters( const std::string& str )
+   {
+      int64_t count = 0;
+      const unsigned char* p = reinterpret_cast< const unsigned char* >( str.data() );
+      const unsigned char* end = p + str.size();
+      while( p != end )
+      {
+         if( end - p >= 8 && is_ascii8( reinterpret_cast< const char* >( p ) ) )
+         {
+            p += 8;
+            count += 8;
+            continue;
+         }
+
+         unsigned char c = *p;
+         if( c < 0x80 )
+         {
+            ++p;
+         }
+         else
+         {
+            size_t   size;
+            uint32_t u;
+            if( c < 0xC2 )      return -1;
+            else if( c < 0xE0 ) { size = 2; u = c & 0x1F; }
+            else if( c < 0xF0 ) { size = 3; u = c & 0x0F; }
+            else if( c < 0xF5 ) { size = 4; u = c & 0x07; }
+            else                return -1;
+
+            if( size_t( end - p ) < size )
+               return -1;
+            for( size_t i = 1; i < size; ++i )
+            {
+               if( ( p[i] & 0xC0 ) != 0x80 )
+                  return -1;
+               u = ( u << 6 ) | ( p[i] & 0x3F );
+            }
+            if( ( size == 3 && u < 0x800 ) || ( size == 4 && u < 0x10000 ) || u > 0x10FFFF || ( u >= 0xD800 && u <= 0xDFFF ) )
+               return -1;
+            p += size;
+         }
+         ++count;
+      }
+      return count;
+   }
+
+   inline bool is_surrogate( uint32_t u ) { return u >= 0xD800 && u <= 0xDFFF; }
+
+   /**
+    *  UTF-8 text being patched.  patch_fromText turns characters outside the BMP into UTF-16
+    *  surrogate pairs, so patches can insert surrogates, they are encoded like any other BMP
+    *  character and dropped by str(), as the conversion back from std::wstring did.
+    *
+    *  Positions are characters.  The byte offset of the last position looked up is kept, patches
+    *  are applied front to back so most lookups only walk a few characters from there.
+    */
+   class utf8_text
+   {
+      public:
+         utf8_text( const std::string& text, size_t length, const std::wstring& padding )
+         {
+            _bytes.reserve( text.size() + 2 * padding.size() );
+            encode( padding, _bytes );
+            _bytes += text;
+            encode( padding, _bytes );
+            _length = length + 2 * padding.size();
+         }
+
+         size_t length()const { return _length; }
+
+         /// byte offset of character pos, pos <= length()
+         size_t offset( size_t pos )
+         {
+            if( pos < _cursor_pos && pos < _cursor_pos - pos )
+            {
+               _cursor_pos = 0;
+               _cursor_byte = 0;
+            }
+            else if( pos > _cursor_pos && _length - pos < pos - _cursor_pos )
+            {
+               _cursor_pos = _length;
+               _cursor_byte = _bytes.size();
+            }
+
+            while( _cursor_pos < pos )
+            {
+               if( pos - _cursor_pos >= 8 && is_ascii8( _bytes.data() + _cursor_byte ) )
+               {
+                  _cursor_pos += 8;
+                  _cursor_byte += 8;
+               }
+               else
+               {
+                  _cursor_byte += sequence_size( _bytes[ _cursor_byte ] );
+                  ++_cursor_pos;
+               }
+            }
+            while( _cursor_pos > pos )
+            {
+               if( _cursor_pos - pos >= 8 && is_ascii8( _bytes.data() + _cursor_byte - 8 ) )
+               {
+                  _cursor_pos -= 8;
+                  _cursor_byte -= 8;
+               }
+               else
+               {
+                  do { --_cursor_byte; } while( ( _bytes[ _cursor_byte ] & 0xC0 ) == 0x80 );
+                  --_cursor_pos;
+               }
+            }
+
+            return _cursor_byte;
+         }
+
+         /// true if the characters at [pos, pos + str.size()) are str
+         bool equals( size_t pos, const std::wstring& str )
+         {
+            if( pos > _length || str.size() > _length - pos )
+               return false;
+
+            size_t byte = offset( pos );
+            for( wchar_t c : str )
+               if( decode( byte ) != uint32_t( c ) )
+                  return false;
+            return true;
+         }
+
+         /// characters [pos, pos + count) clipped to the end of the text, like std::wstring::substr
+         std::wstring substr( size_t pos, size_t count )
+         {
+            if( pos > _length )
+               throw std::out_of_range( "utf8_text::substr" );
+
+            count = std::min( count, _length - pos );
+            std::wstring result;
+            result.reserve( count );
+            size_t byte = offset( pos );
+            for( size_t i = 0; i < count; ++i )
+               result.push_back( wchar_t( decode( byte ) ) );
+            return result;
+         }
+
+         /// characters [pos, pos + count), which must be within the text
+         void characters( size_t pos, size_t count, std::vector< uint32_t >& result )
+         {
+            result.resize( count );
+            size_t byte = offset( pos );
+            for( size_t i = 0; i < count; ++i )
+               result[i] = decode( byte );
+         }
+
+         /**
+          *  Position of the occurrence of str std::wstring::find (or rfind if reverse) would return
+          *  when searching from pos.  Occurrences more than max_distance characters away from near
+          *  are only reported as found, with far set.
+          */
+         bool find( const std::wstring& str, size_t pos, bool reverse, size_t near, size_t max_distance, size_t& result, bool& far )
+         {
+            std::string pattern;
+            encode( str, pattern );
+
+            size_t byte = reverse ? _bytes.rfind( pattern, offset( std::min( pos, _length ) ) )
+                                  : _bytes.find( pattern, offset( std::min( pos, _length ) ) );
+            if( byte == std::string::npos )
+               return false;
+
+            // a character is at most four bytes, so anything further away than this is far
+            size_t near_byte = offset( near );
+            far = ( byte > near_byte ? byte - near_byte : near_byte - byte ) > 4 * ( max_distance + 1 );
+            if( far )
+               return true;
+
+            size_t distance = 0;
+            if( byte >= near_byte )
+               for( size_t b = near_byte; b < byte; b += sequence_size( _bytes[b] ) ) ++distance;
+            else
+               for( size_t b = byte; b < near_byte; b += sequence_size( _bytes[b] ) ) ++distance;
+
+            far = distance > max_distance;
+            result = byte >= near_byte ? near + distance : near - distance;
+            return true;
+         }
+
+         /// replaces the characters [pos, pos + count), which must be within the text, with str
+         void replace( size_t pos, size_t count, const std::wstring& str )
+         {
+            size_t begin = offset( pos );
+            size_t end = offset( pos + count );
+
+            std::string bytes;
+            encode( str, bytes );
+            _bytes.replace( begin, end - begin, bytes );
+            _length = _length - count + str.size();
+
+            _cursor_pos = pos;
+            _cursor_byte = begin;
+         }
+
+         /// the text becomes text[0, keep) + text[from, length()), keep is clipped to the text, from must be within it
+         void splice( size_t keep, size_t from )
+         {
+            keep = std::min( keep, _length );
+            if( keep <= from )
+            {
+               replace( keep, from - keep, std::wstring() );
+               return;
+            }
+
+            size_t from_byte = offset( from );
+            size_t keep_byte = offset( keep );
+            std::string repeated = _bytes.substr( from_byte, keep_byte - from_byte );
+            _bytes.insert( keep_byte, repeated );
+            _length += keep - from;
+
+            _cursor_pos = from;
+            _cursor_byte = from_byte;
+         }
+
+         /// UTF-8 of the characters [pos, pos + count), without surrogates
+         std::string str( size_t pos, size_t count )
+         {
+            size_t begin = offset( pos );
+            size_t end = offset( pos + count );
+            if( !_has_surrogates )
+               return _bytes.substr( begin, end - begin );
+
+            // surrogates are the only sequences starting with 0xED followed by 0xA0 or above
+            std::string result;
+            result.reserve( end - begin );
+            size_t copied = begin;
+            for( size_t byte = _bytes.find( '\xED', begin ); byte < end; byte = _bytes.find( '\xED', byte + 3 ) )
+            {
+               if( ( unsigned char )_bytes[ byte + 1 ] < 0xA0 )
+                  continue;
+               result.append( _bytes, copied, byte - copied );
+               copied = byte + 3;
+            }
+            result.append( _bytes, copied, end - copied );
+            return result;
+         }
+
+      private:
+         static size_t sequence_size( char c )
+         {
+            unsigned char u = c;
+            return u < 0x80 ? 1 : u < 0xE0 ? 2 : u < 0xF0 ? 3 : 4;
+         }
+
+         uint32_t decode( size_t& byte )const
+         {
+            unsigned char c = _bytes[ byte++ ];
+            if( c < 0x80 )
+               return c;
+
+            size_t   size = sequence_size( c );
+            uint32_t u = c & ( size == 2 ? 0x1F : size == 3 ? 0x0F : 0x07 );
+            for( size_t i = 1; i < size; ++i )
+               u = ( u << 6 ) | ( _bytes[ byte++ ] & 0x3F );
+            return u;
+         }
+
+         void encode( const std::wstring& str, std::string& out )
+         {
+            for( wchar_t c : str )
+            {
+               uint32_t u = c;
+               if( u < 0x80 )
+                  out += char( u );
+               else if( u < 0x800 )
+               {
+                  out += char( 0xC0 | ( u >> 6 ) );
+                  out += char( 0x80 | ( u & 0x3F ) );
+               }
+               else if( u < 0x10000 )
+               {
+                  _has_surrogates |= is_surrogate( u );
+                  out += char( 0xE0 | ( u >> 12 ) );
+                  out += char( 0x80 | ( ( u >> 6 ) & 0x3F ) );
+                  out += char( 0x80 | ( u & 0x3F ) );
+               }
+               else
+               {
+                  out += char( 0xF0 | ( u >> 18 ) );
+                  out += char( 0x80 | ( ( u >> 12 ) & 0x3F ) );
+                  out += char( 0x80 | ( ( u >> 6 ) & 0x3F ) );
+                  out += char( 0x80 | ( u & 0x3F ) );
+               }
+            }
+         }
+
+         std::string _bytes;
+         size_t      _length = 0;
+         size_t      _cursor_pos = 0;
+         size_t      _cursor_byte = 0;
+         bool        _has_surrogates = false;
+   };
+
+   /**
+    *  patch_apply, match_main and match_bitap of diff_match_patch over utf8_text.  The diffs
+    *  between a patch and the text it fuzzily matched are still computed by diff_match_patch,
+    *  both are only about as long as the patch.
+    */
+   class utf8_patcher
+   {
+      public:
+         utf8_patcher( const dmp_type& dmp, utf8_text& text ) : _dmp( dmp ), _text( text ) {}
+
+         void apply( const dmp_type::Patches& patches )
+         {
+            const int max_bits = _dmp.Match_MaxBits;
+
+            // delta keeps track of the offset between the expected and actual location of the previous patch
+            int delta = 0;
+            for( const auto& patch : patches )
+            {
+               int expected_loc = patch.start2 + delta;
+               std::wstring text1 = dmp_type::diff_text1( patch.diffs );
+               int start_loc;
+               int end_loc = -1;
+               if( int( text1.length() ) > max_bits )
+               {
+                  // patch_splitMax only leaves oversized patterns for big deletions
+                  start_loc = match_main( text1.substr( 0, max_bits ), expected_loc );
+                  if( start_loc != -1 )
+                  {
+                     end_loc = match_main( text1.substr( text1.size() - max_bits ), int( expected_loc + int64_t( text1.length() ) - max_bits ) );
+                     if( end_loc == -1 || start_loc >= end_loc )
+                        start_loc = -1;
+                  }
+               }
+               else
+               {
+                  start_loc = match_main( text1, expected_loc );
+               }
+
+               if( start_loc == -1 )
+               {
+                  delta -= patch.length2 - patch.length1;
+                  continue;
+               }
+
+               delta = start_loc - expected_loc;
+               size_t text2_length = end_loc == -1 ? text1.length() : size_t( end_loc + max_bits - start_loc );
+               text2_length = std::min( text2_length, _text.length() - start_loc );
+               if( text2_length == text1.length() && _text.equals( start_loc, text1 ) )
+               {
+                  _text.replace( start_loc, text1.length(), dmp_type::diff_text2( patch.diffs ) );
+                  continue;
+               }
+
+               // imperfect match, run a diff to get a framework of equivalent indices
+               std::wstring text2 = start_loc == int( _text.length() ) ? std::wstring() : _text.substr( start_loc, text2_length );
+               auto diffs = _dmp.diff_main( text1, text2, false );
+               if( int( text1.length() ) > max_bits
+                   && dmp_type::diff_levenshtein( diffs ) / static_cast< float >( text1.length() ) > _dmp.Patch_DeleteThreshold )
+                  continue;
+
+               dmp_type::diff_cleanupSemanticLossless( diffs );
+               int index1 = 0;
+               for( const auto& diff : patch.diffs )
+               {
+                  if( diff.operation != dmp_type::EQUAL )
+                  {
+                     size_t index2 = start_loc + dmp_type::diff_xIndex( diffs, index1 );
+                     if( diff.operation == dmp_type::INSERT )
+                     {
+                        if( index2 > _text.length() )
+                           throw std::out_of_range( "patch insertion past the end of the text" );
+                        _text.replace( index2, 0, diff.text );
+                     }
+                     else if( diff.operation == dmp_type::DELETE )
+                     {
+                        size_t end = start_loc + dmp_type::diff_xIndex( diffs, index1 + diff.text.length() );
+                        if( end > _text.length() )
+                           throw std::out_of_range( "patch deletion past the end of the text" );
+                        _text.splice( index2, end );
+                     }
+                  }
+                  if( diff.operation != dmp_type::DELETE )
+                     index1 += diff.text.length();
+               }
+            }
+         }
+
+      private:
+         int match_main( const std::wstring& pattern, int loc )
+         {
+            int length = int( _text.length() );
+            loc = std::max( 0, std::min( loc, length ) );
+            if( size_t( length ) == pattern.size() && _text.equals( 0, pattern ) )
+               return 0;
+            else if( length == 0 )
+               return -1;
+            else if( loc + pattern.size() <= size_t( length ) && _text.equals( loc, pattern ) )
+               return loc;
+            else
+               return match_bitap( pattern, loc );
+         }
+
+         /**
+          *  match_bitap of diff_match_patch.  Matches further than Match_Distance * Match_Threshold
+          *  characters from loc score above the threshold, so only the characters in reach of the
+          *  first pass are decoded.  Bit arrays start zeroed, diff_match_patch reads uninitialized
+          *  entries in some later passes.
+          */
+         int match_bitap( const std::wstring& pattern, int loc )
+         {
+            const int pattern_length = pattern.length();
+            const int text_length = _text.length();
+            if( !( _dmp.Match_MaxBits == 0 || pattern_length <= _dmp.Match_MaxBits ) )
+               throw std::length_error( "Pattern too long for this application." );
+
+            std::map< uint32_t, uint32_t > alphabet;
+            for( int i = 0; i < pattern_length; ++i )
+               alphabet[ uint32_t( pattern[i] ) ] |= 1u << ( pattern_length - i - 1 );
+
+            // is there a nearby exact match?
+            double score_threshold = _dmp.Match_Threshold;
+            const size_t max_distance = size_t( _dmp.Match_Threshold * _dmp.Match_Distance ) + 1;
+            size_t best;
+            bool   far;
+            if( _text.find( pattern, loc, false, loc, max_distance, best, far ) )
+            {
+               if( !far )
+                  score_threshold = std::min( score( 0, best, loc, pattern_length ), score_threshold );
+               if( _text.find( pattern, loc + pattern_length, true, loc, max_distance, best, far ) && !far )
+                  score_threshold = std::min( score( 0, best, loc, pattern_length ), score_threshold );
+            }
+
+            const uint32_t matchmask = 1u << ( pattern_length - 1 );
+            int best_loc = -1;
+
+            int bin_min, bin_mid;
+            int bin_max = pattern_length + text_length;
+
+            // characters [window, window + chars.size()) and bit array entries [window, window + size)
+            int window = 0;
+            std::vector< uint32_t > chars;
+            std::vector< uint32_t > rd, last_rd;
+            for( int d = 0; d < pattern_length; ++d )
+            {
+               // how far from loc can we stray at this error level
+               bin_min = 0;
+               bin_mid = bin_max;
+               while( bin_min < bin_mid )
+               {
+                  if( score( d, loc + bin_mid, loc, pattern_length ) <= score_threshold )
+                     bin_min = bin_mid;
+                  else
+                     bin_max = bin_mid;
+                  bin_mid = ( bin_max - bin_min ) / 2 + bin_min;
+               }
+               bin_max = bin_mid;
+               int start = std::max( 1, loc - bin_mid + 1 );
+               int finish = std::min( loc + bin_mid, text_length ) + pattern_length;
+
+               if( d == 0 )
+               {
+                  // later passes search a narrower range, and a match past loc moves start at most one further down
+                  window = std::max( 0, loc - bin_mid - 1 );
+                  _text.characters( window, std::min( finish, text_length ) - window, chars );
+                  last_rd.assign( finish + 2 - window, 0 );
+               }
+               rd.assign( last_rd.size(), 0 );
+
+               rd[ finish + 1 - window ] = ( 1u << d ) - 1;
+               for( int j = finish; j >= start; --j )
+               {
+                  uint32_t char_match = 0;
+                  if( j - 1 < text_length )
+                  {
+                     auto itr = alphabet.find( chars[ j - 1 - window ] );
+                     if( itr != alphabet.end() )
+                        char_match = itr->second;
+                  }
+
+                  uint32_t& r = rd[ j - window ];
+                  if( d == 0 )
+                     r = ( ( rd[ j + 1 - window ] << 1 ) | 1 ) & char_match;
+                  else
+                     r = ( ( ( rd[ j + 1 - window ] << 1 ) | 1 ) & char_match )
+                       | ( ( ( last_rd[ j + 1 - window ] | last_rd[ j - window ] ) << 1 ) | 1 )
+                       | last_rd[ j + 1 - window ];
+
+                  if( r & matchmask )
+                  {
+                     double s = score( d, j - 1, loc, pattern_length );
+                     if( s <= score_threshold )
+                     {
+                        score_threshold = s;
+                        best_loc = j - 1;
+                        if( best_loc > loc )
+                           start = std::max( 1, 2 * loc - best_loc );
+                        else
+                           break;
+                     }
+                  }
+               }
+               if( score( d + 1, loc, loc, pattern_length ) > score_threshold )
+                  break;
+               std::swap( rd, last_rd );
+            }
+            return best_loc;
+         }
+
+         /// match_bitapScore of diff_match_patch, computed in float like there
+         double score( int e, int x, int loc, int pattern_length )const
+         {
+            const float accuracy = static_cast< float >( e ) / size_t( pattern_length );
+            const int proximity = loc - x < 0 ? x - loc : loc - x;
+            if( _dmp.Match_Distance == 0 )
+               return proximity == 0 ? accuracy : 1.0;
+            return accuracy + ( proximity / static_cast< float >( _dmp.Match_Distance ) );
+         }
+
+         const dmp_type&   _dmp;
+         utf8_text&        _text;
+   };
+
+} // anonymous
+
+bool apply_utf8_patch( const std::string& patch_text, const std::string& text, std::string& result )
+{
+   if( !may_start_with_patch_header( patch_text ) )
+      return false;
+
+   // positions in patches are std::wstring characters, which are code points only where wchar_t is 32 bits
+   int64_t length = count_characters( text );
+   if( sizeof( wchar_t ) < 4 || length < 0 )
+      return apply_wstring_patch( patch_text, text, result );
+
+   dmp_type dmp;
+   auto patches = dmp.patch_fromText( utf8_to_wstring( patch_text ) );
+   if( patches.empty() )
+      return false;
+
+   std::wstring padding = dmp.patch_addPadding( patches );
+   utf8_text patched( text, length, padding );
+   dmp.patch_splitMax( patches );
+
+   utf8_patcher( dmp, patched ).apply( patches );
+
+   // strip the padding off, with the bounds diff_match_patch uses
+   size_t pad = padding.size();
+   if( pad > patched.length() )
+      throw std::out_of_range( "patched text is shorter than its padding" );
+   size_t count = patched.length() - pad;
+   if( patched.length() >= 2 * pad )
+      count -= pad;
+   result = patched.str( pad, count );
+   return true;
+}
+
+bool apply_wstring_patch( const std::string& patch_text, const std::string& text, std::string& result )
+{
+   dmp_type dmp;
+   auto patches = dmp.patch_fromText( utf8_to_wstring( patch_text ) );
+   if( patches.empty() )
+      return false;
+
+   result = wstring_to_utf8( dmp.patch_apply( patches, utf8_to_wstring( text ) ).first );
+   return true;
+}
+
+} } // sigmaengine::dapp
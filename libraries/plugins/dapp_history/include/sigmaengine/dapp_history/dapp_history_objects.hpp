@@ -15,7 +15,8 @@ namespace sigmaengine { namespace dapp_history {
 
    enum dapp_history_by_key_object_type
    {
-      dapp_history_object_type              = (DAPP_HISTORY_SPACE_ID << 8)
+      dapp_history_object_type              = (DAPP_HISTORY_SPACE_ID << 8),
+      dapp_history_sequence_object_type     = (DAPP_HISTORY_SPACE_ID << 8) + 1
    };
 
    class dapp_history_object : public object< dapp_history_object_type, dapp_history_object >
@@ -56,8 +57,42 @@ namespace sigmaengine { namespace dapp_history {
       allocator< dapp_history_object >
    > dapp_history_index;
 
+   /// the sequence the next dapp_history_object of a dapp gets
+   class dapp_history_sequence_object : public object< dapp_history_sequence_object_type, dapp_history_sequence_object >
+   {
+      public:
+         template< typename Constructor, typename Allocator >
+         dapp_history_sequence_object( Constructor&& c, allocator< Allocator > a )
+         {
+            c( *this );
+         }
+
+         id_type                 id;
+
+         dapp_name_type          dapp_name;
+         uint32_t                next_sequence = 0;
+   };
+
+   typedef oid< dapp_history_sequence_object > dapp_history_sequence_id_type;
+
+   typedef multi_index_container<
+      dapp_history_sequence_object,
+      indexed_by<
+         ordered_unique< tag< by_id >,
+            member< dapp_history_sequence_object, dapp_history_sequence_id_type, &dapp_history_sequence_object::id >
+         >,
+         ordered_unique< tag< by_dapp_name >,
+            member< dapp_history_sequence_object, dapp_name_type, &dapp_history_sequence_object::dapp_name >
+         >
+      >,
+      allocator< dapp_history_sequence_object >
+   > dapp_history_sequence_index;
+
 } } //namespace sigmaengine::dapp_history
 
 FC_REFLECT( sigmaengine::dapp_history::dapp_history_object, (id)(dapp_name)(sequence)(op) )
 CHAINBASE_SET_INDEX_TYPE( sigmaengine::dapp_history::dapp_history_object, sigmaengine::dapp_history::dapp_history_index )
 
+FC_REFLECT( sigmaengine::dapp_history::dapp_history_sequence_object, (id)(dapp_name)(next_sequence) )
+CHAINBASE_SET_INDEX_TYPE( sigmaengine::dapp_history::dapp_history_sequence_object, sigmaengine::dapp_history::dapp_history_sequence_index )
+
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <sigmaengine/chain/sigmaengine_object_types.hpp>
+#include <sigmaengine/protocol/operations.hpp>
+
+namespace sigmaengine { namespace plugin { namespace operation_stream {
+
+struct streamed_operation
+{
+   chain::transaction_id_type trx_id;
+   uint32_t                   trx_in_block = 0;
+   uint16_t                   op_in_trx    = 0;
+   uint64_t                   virtual_op   = 0;
+   protocol::operation        op;
+};
+
+/**
+ *  One notification per applied block containing the operations of that block which match
+ *  the subscription filter.  Blocks without matching operations are not sent.
+ *
+ *  If the subscriber does not keep up, a final notification with overflow set is sent and the
+ *  subscription is dropped.  block_num of that notification is the first block which was not
+ *  delivered, subscribing again with start_block set to it resumes the stream without a gap.
+ *
+ *  When a fork switch pops a block, a notification with rollback set and the block_num and
+ *  block_id of the popped block is sent.  Operations delivered for that block no longer apply,
+ *  the blocks of the new fork follow with the same numbers.
+ */
+struct streamed_block
+{
+   uint32_t                          block_num = 0;
+   chain::block_id_type              block_id;
+   fc::time_point_sec                timestamp;
+   bool                              overflow = false;
+   bool                              rollback = false;
+   std::vector< streamed_operation > operations;
+};
+
+/**
+ *  Empty sets match everything.  Operation names are given without namespace, e.g. "transfer_operation".
+ */
+struct operation_stream_filter
+{
+   fc::flat_set< protocol::account_name_type > accounts;
+   fc::flat_set< std::string >                 operations;
+   fc::flat_set< protocol::dapp_name_type >    dapps;
+   fc::optional< uint32_t >                    start_block;
+};
+
+} } }
+
+FC_REFLECT( sigmaengine::plugin::operation_stream::streamed_operation,
+   (trx_id)
+   (trx_in_block)
+   (op_in_trx)
+   (virtual_op)
+   (op)
+   )
+
+FC_REFLECT( sigmaengine::plugin::operation_stream::streamed_block,
+   (block_num)
+   (block_id)
+   (timestamp)
+   (overflow)
+   (rollback)
+   (operations)
+   )
+
+FC_REFLECT( sigmaengine::plugin::operation_stream::operation_stream_filter,
+   (accounts)
+   (operations)
+   (dapps)
+   (start_block)
+   )
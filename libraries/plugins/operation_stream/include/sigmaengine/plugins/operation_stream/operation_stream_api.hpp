@@ -0,0 +1,45 @@
+#pragma once
+
+#include <fc/api.hpp>
+#include <fc/rpc/encoded_variant.hpp>
+
+#include <sigmaengine/plugins/operation_stream/operation_stream.hpp>
+
+namespace sigmaengine { namespace app {
+   struct api_context;
+} }
+
+namespace sigmaengine { namespace plugin { namespace operation_stream {
+
+namespace detail {
+class operation_stream_api_impl;
+}
+
+class operation_stream_api
+{
+   public:
+      operation_stream_api( const sigmaengine::app::api_context& ctx );
+
+      void on_api_startup();
+
+      /**
+       *  Replaces the current subscription of this connection.  cb receives a streamed_block for
+       *  every applied block with matching operations, starting at filter.start_block if given.
+       *  Fails if start_block is older than get_oldest_streamable_block() or past the next block.
+       */
+      void subscribe_operations( std::function< void( const fc::rpc::encoded_variant& ) > cb, operation_stream_filter filter );
+      void unsubscribe_operations();
+
+      uint32_t get_oldest_streamable_block()const;
+
+   private:
+      std::shared_ptr< detail::operation_stream_api_impl > my;
+};
+
+} } }
+
+FC_API( sigmaengine::plugin::operation_stream::operation_stream_api,
+   (subscribe_operations)
+   (unsubscribe_operations)
+   (get_oldest_streamable_block)
+   )
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <sigmaengine/app/plugin.hpp>
+#include <sigmaengine/plugins/operation_stream/operation_stream.hpp>
+
+#include <fc/rpc/encoded_variant.hpp>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace sigmaengine { namespace plugin { namespace operation_stream {
+
+using sigmaengine::app::application;
+
+namespace detail {
+class operation_stream_plugin_impl;
+class operation_subscription;
+}
+
+typedef std::shared_ptr< detail::operation_subscription > operation_subscription_ptr;
+
+/**
+ *  Encodes every applied block once, and every distinct subset of its operations matched by a
+ *  filter once, and pushes the encoded block to all subscribers whose filter matches.  Their
+ *  connections copy it into their frames without encoding it again.  Delivery happens on a separate thread so a slow subscriber never
+ *  delays block application, each subscriber has a bounded queue of pending blocks.
+ *
+ *  The last operation-stream-history-blocks blocks are kept in memory so subscribers can
+ *  resume from an earlier block.
+ */
+class operation_stream_plugin : public sigmaengine::app::plugin
+{
+   public:
+      operation_stream_plugin( application* app );
+      virtual ~operation_stream_plugin();
+
+      virtual std::string plugin_name()const override;
+      virtual void plugin_set_program_options(
+         boost::program_options::options_description& cli,
+         boost::program_options::options_description& cfg ) override;
+      virtual void plugin_initialize( const boost::program_options::variables_map& options ) override;
+      virtual void plugin_startup() override;
+      virtual void plugin_shutdown() override;
+
+      operation_subscription_ptr subscribe( const operation_stream_filter& filter, std::function< void( const fc::rpc::encoded_variant& ) > cb );
+      void                       unsubscribe( const operation_subscription_ptr& sub );
+
+      /// first block which can be passed as start_block, 0 if nothing has been recorded yet
+      uint32_t                   get_oldest_block()const;
+
+   private:
+      friend class detail::operation_stream_plugin_impl;
+      std::unique_ptr< detail::operation_stream_plugin_impl > my;
+};
+
+} } }
@@ -0,0 +1,66 @@
+#include <sigmaengine/app/api_context.hpp>
+#include <sigmaengine/app/application.hpp>
+
+#include <sigmaengine/plugins/operation_stream/operation_stream_api.hpp>
+#include <sigmaengine/plugins/operation_stream/operation_stream_plugin.hpp>
+
+namespace sigmaengine { namespace plugin { namespace operation_stream {
+
+namespace detail {
+
+class operation_stream_api_impl
+{
+   public:
+      operation_stream_api_impl( sigmaengine::app::application& _app );
+      ~operation_stream_api_impl();
+
+      std::shared_ptr< sigmaengine::plugin::operation_stream::operation_stream_plugin > get_plugin()const;
+
+      sigmaengine::app::application& app;
+      operation_subscription_ptr     subscription;
+};
+
+operation_stream_api_impl::operation_stream_api_impl( sigmaengine::app::application& _app ) : app( _app )
+{}
+
+operation_stream_api_impl::~operation_stream_api_impl()
+{
+   // the connection is closed, stop pushing to it
+   if( subscription )
+      get_plugin()->unsubscribe( subscription );
+}
+
+std::shared_ptr< sigmaengine::plugin::operation_stream::operation_stream_plugin > operation_stream_api_impl::get_plugin()const
+{
+   return app.get_plugin< operation_stream_plugin >( "operation_stream" );
+}
+
+} // detail
+
+operation_stream_api::operation_stream_api( const sigmaengine::app::api_context& ctx )
+{
+   my = std::make_shared< detail::operation_stream_api_impl >( ctx.app );
+}
+
+void operation_stream_api::subscribe_operations( std::function< void( const fc::rpc::encoded_variant& ) > cb, operation_stream_filter filter )
+{
+   auto plugin = my->get_plugin();
+   plugin->unsubscribe( my->subscription );
+   my->subscription.reset();
+   my->subscription = plugin->subscribe( filter, cb );
+}
+
+void operation_stream_api::unsubscribe_operations()
+{
+   my->get_plugin()->unsubscribe( my->subscription );
+   my->subscription.reset();
+}
+
+uint32_t operation_stream_api::get_oldest_streamable_block()const
+{
+   return my->get_plugin()->get_oldest_block();
+}
+
+void operation_stream_api::on_api_startup() { }
+
+} } } // sigmaengine::plugin::operation_stream
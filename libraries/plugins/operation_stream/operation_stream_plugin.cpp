@@ -0,0 +1,477 @@
+#include <sigmaengine/chain/database.hpp>
+#include <sigmaengine/chain/operation_notification.hpp>
+
+#include <sigmaengine/app/impacted.hpp>
+#include <sigmaengine/dapp_history/dapp_impacted.hpp>
+
+#include <sigmaengine/plugins/operation_stream/operation_stream_api.hpp>
+#include <sigmaengine/plugins/operation_stream/operation_stream_plugin.hpp>
+
+#include <fc/thread/thread.hpp>
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+
+namespace sigmaengine { namespace plugin { namespace operation_stream {
+
+namespace detail {
+
+using namespace sigmaengine::protocol;
+using chain::operation_notification;
+using chain::signed_block;
+
+/// keys an operation can be filtered by, computed once when the operation is applied
+struct operation_keys
+{
+   int64_t                          op_tag = 0;
+   flat_set< account_name_type >    accounts;
+   flat_set< dapp_name_type >       dapps;
+};
+
+struct recorded_block
+{
+   std::shared_ptr< const streamed_block >  block;
+   std::vector< operation_keys >            keys;
+   fc::variants                             operations; ///< variant of each operation, built when the block is first encoded
+   fc::rpc::encoded_variant                 encoded;    ///< the whole block, shared by all subscribers matching every operation
+};
+
+/// filtered blocks by the indexes of the operations they contain, so equal results are encoded once
+typedef std::map< std::vector< uint32_t >, fc::rpc::encoded_variant > encoded_results;
+
+template< typename Set >
+bool intersects( const Set& a, const Set& b )
+{
+   if( a.size() > b.size() )
+      return intersects( b, a );
+   for( const auto& item : a )
+      if( b.find( item ) != b.end() )
+         return true;
+   return false;
+}
+
+class operation_subscription
+{
+   public:
+      bool matches_all()const
+      {
+         return accounts.empty() && op_tags.empty() && dapps.empty();
+      }
+
+      bool matches( const operation_keys& keys )const
+      {
+         if( op_tags.size() && op_tags.find( keys.op_tag ) == op_tags.end() )
+            return false;
+         if( accounts.size() && !intersects( accounts, keys.accounts ) )
+            return false;
+         if( dapps.size() && !intersects( dapps, keys.dapps ) )
+            return false;
+         return true;
+      }
+
+      /// runs on the delivery thread until the queue is empty
+      void drain();
+
+      void close()
+      {
+         std::lock_guard< std::mutex > lock( mutex );
+         closed = true;
+         queue.clear();
+      }
+
+      flat_set< account_name_type >                  accounts;
+      flat_set< int64_t >                            op_tags;
+      flat_set< dapp_name_type >                     dapps;
+      std::function< void( const fc::rpc::encoded_variant& ) > callback;
+
+      std::mutex                                     mutex; ///< guards the members below
+      std::deque< std::pair< uint32_t, fc::rpc::encoded_variant > > queue;
+      bool                                           delivering = false;
+      bool                                           closed = false;
+};
+
+void operation_subscription::drain()
+{
+   while( true )
+   {
+      fc::rpc::encoded_variant msg;
+      {
+         std::lock_guard< std::mutex > lock( mutex );
+         if( queue.empty() )
+         {
+            delivering = false;
+            return;
+         }
+         msg = queue.front().second;
+         queue.pop_front();
+      }
+
+      try
+      {
+         callback( msg );
+      }
+      catch( ... )
+      {
+         // the connection is gone, the plugin drops the subscription on the next block
+         std::lock_guard< std::mutex > lock( mutex );
+         closed = true;
+         queue.clear();
+         delivering = false;
+         return;
+      }
+   }
+}
+
+struct operation_name_visitor
+{
+   typedef std::string result_type;
+
+   template< typename T >
+   std::string operator()( const T& )const
+   {
+      std::string name = fc::get_typename< T >::name();
+      auto pos = name.rfind( ':' );
+      return pos == std::string::npos ? name : name.substr( pos + 1 );
+   }
+};
+
+class operation_stream_plugin_impl
+{
+   public:
+      operation_stream_plugin_impl( operation_stream_plugin& _plugin )
+         : _self( _plugin ), _delivery_thread( "operation_stream" ) {}
+
+      chain::database& database()
+      {
+         return _self.database();
+      }
+
+      void on_pre_apply_block( const signed_block& b );
+      void on_operation( const operation_notification& note );
+      void on_applied_block( const signed_block& b );
+      void on_popped_block( const signed_block& b );
+
+      /// the operations of rec matching sub, invalid if there are none. Caller holds _mutex.
+      fc::rpc::encoded_variant encode( recorded_block& rec, const operation_subscription& sub, encoded_results& results );
+
+      /// queues msg for sub, returns false if the subscription has to be dropped. Caller holds _mutex.
+      bool push( const operation_subscription_ptr& sub, uint32_t block_num, const fc::rpc::encoded_variant& msg, bool limit = true );
+
+      operation_stream_plugin&                  _self;
+      flat_map< std::string, int64_t >          _op_tags_by_name;
+      uint32_t                                  _history_blocks = 1200;
+      uint32_t                                  _max_pending_blocks = 200;
+
+      // only touched from the write thread
+      std::shared_ptr< streamed_block >         _current;
+      std::vector< operation_keys >             _current_keys;
+
+      mutable std::mutex                        _mutex; ///< guards _history and _subscriptions
+      std::deque< recorded_block >              _history;
+      std::set< operation_subscription_ptr >    _subscriptions;
+
+      fc::thread                                _delivery_thread;
+
+      boost::signals2::scoped_connection        _pre_apply_block_conn;
+      boost::signals2::scoped_connection        _post_apply_operation_conn;
+      boost::signals2::scoped_connection        _applied_block_conn;
+      boost::signals2::scoped_connection        _popped_block_conn;
+};
+
+void operation_stream_plugin_impl::on_pre_apply_block( const signed_block& b )
+{
+   _current = std::make_shared< streamed_block >();
+   _current->block_num = b.block_num();
+   _current->block_id  = b.id();
+   _current->timestamp = b.timestamp;
+   _current_keys.clear();
+}
+
+void operation_stream_plugin_impl::on_operation( const operation_notification& note )
+{
+   // operations of pending transactions are not streamed, only those of applied blocks
+   if( !_current || note.block != _current->block_num )
+      return;
+
+   chain::database& db = database();
+
+   _current->operations.emplace_back();
+   streamed_operation& sop = _current->operations.back();
+   sop.trx_id       = note.trx_id;
+   sop.trx_in_block = note.trx_in_block;
+   sop.op_in_trx    = note.op_in_trx;
+   sop.virtual_op   = note.virtual_op;
+   sop.op           = note.op;
+
+   _current_keys.emplace_back();
+   operation_keys& keys = _current_keys.back();
+   keys.op_tag = note.op.which();
+   app::operation_get_impacted_accounts( note.op, db, keys.accounts );
+   dapp_history::operation_get_impacted_dapp( note.op, db, keys.dapps );
+}
+
+void operation_stream_plugin_impl::on_applied_block( const signed_block& b )
+{
+   if( !_current || _current->block_num != b.block_num() )
+      return;
+
+   recorded_block rec;
+   rec.block = _current;
+   rec.keys  = std::move( _current_keys );
+   _current.reset();
+   _current_keys.clear();
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   // a fork switch re-applies blocks we have already recorded
+   while( _history.size() && _history.back().block->block_num >= rec.block->block_num )
+      _history.pop_back();
+
+   _history.push_back( std::move( rec ) );
+   while( _history.size() > std::max< uint32_t >( _history_blocks, 1 ) )
+      _history.pop_front();
+
+   recorded_block& current = _history.back();
+   encoded_results results;
+   for( auto itr = _subscriptions.begin(); itr != _subscriptions.end(); )
+   {
+      auto msg = encode( current, **itr, results );
+      if( msg.valid() && !push( *itr, current.block->block_num, msg ) )
+         itr = _subscriptions.erase( itr );
+      else
+         ++itr;
+   }
+}
+
+void operation_stream_plugin_impl::on_popped_block( const signed_block& b )
+{
+   streamed_block notice;
+   notice.block_num = b.block_num();
+   notice.block_id  = b.id();
+   notice.rollback  = true;
+   auto msg = fc::rpc::encoded_variant( fc::variant( notice ) );
+
+   std::lock_guard< std::mutex > lock( _mutex );
+
+   while( _history.size() && _history.back().block->block_num >= notice.block_num )
+      _history.pop_back();
+
+   for( auto itr = _subscriptions.begin(); itr != _subscriptions.end(); )
+   {
+      if( !push( *itr, notice.block_num, msg ) )
+         itr = _subscriptions.erase( itr );
+      else
+         ++itr;
+   }
+}
+
+fc::rpc::encoded_variant operation_stream_plugin_impl::encode( recorded_block& rec, const operation_subscription& sub, encoded_results& results )
+{
+   std::vector< uint32_t > matched;
+   if( !sub.matches_all() )
+   {
+      for( uint32_t i = 0; i < rec.keys.size(); ++i )
+      {
+         if( sub.matches( rec.keys[i] ) )
+            matched.push_back( i );
+      }
+      if( matched.empty() )
+         return fc::rpc::encoded_variant();
+   }
+
+   bool whole_block = sub.matches_all() || matched.size() == rec.keys.size();
+   fc::rpc::encoded_variant& result = whole_block ? rec.encoded : results[ matched ];
+   if( result.valid() )
+      return result;
+
+   // the variants of the operations are shared by every block built from them
+   if( rec.operations.size() != rec.block->operations.size() )
+   {
+      rec.operations.clear();
+      rec.operations.reserve( rec.block->operations.size() );
+      for( const auto& op : rec.block->operations )
+         rec.operations.emplace_back( op );
+   }
+
+   streamed_block header;
+   header.block_num = rec.block->block_num;
+   header.block_id  = rec.block->block_id;
+   header.timestamp = rec.block->timestamp;
+   fc::mutable_variant_object block( fc::variant( header ).get_object() );
+   if( whole_block )
+   {
+      block.set( "operations", rec.operations );
+   }
+   else
+   {
+      fc::variants operations;
+      operations.reserve( matched.size() );
+      for( uint32_t i : matched )
+         operations.push_back( rec.operations[i] );
+      block.set( "operations", std::move( operations ) );
+   }
+
+   result = fc::rpc::encoded_variant( fc::variant( std::move( block ) ) );
+   return result;
+}
+
+bool operation_stream_plugin_impl::push( const operation_subscription_ptr& sub, uint32_t block_num,
+                                         const fc::rpc::encoded_variant& msg, bool limit )
+{
+   std::lock_guard< std::mutex > lock( sub->mutex );
+   if( sub->closed )
+      return false;
+
+   if( limit && sub->queue.size() >= _max_pending_blocks )
+   {
+      streamed_block notice;
+      notice.block_num = sub->queue.size() ? sub->queue.front().first : block_num;
+      notice.overflow  = true;
+      sub->queue.clear();
+      sub->queue.emplace_back( notice.block_num, fc::rpc::encoded_variant( fc::variant( notice ) ) );
+      sub->closed = true;
+      wlog( "Operation stream subscriber is ${n} blocks behind, dropping it at block ${b}", ("n",_max_pending_blocks)("b",notice.block_num) );
+   }
+   else
+   {
+      sub->queue.emplace_back( block_num, msg );
+   }
+
+   if( !sub->delivering )
+   {
+      sub->delivering = true;
+      _delivery_thread.async( [sub](){ sub->drain(); }, "operation_stream_deliver" );
+   }
+
+   return !sub->closed;
+}
+
+} // detail
+
+operation_stream_plugin::operation_stream_plugin( application* app )
+   : plugin( app ), my( new detail::operation_stream_plugin_impl( *this ) ) {}
+
+operation_stream_plugin::~operation_stream_plugin() {}
+
+std::string operation_stream_plugin::plugin_name()const
+{
+   return "operation_stream";
+}
+
+void operation_stream_plugin::plugin_set_program_options(
+   boost::program_options::options_description& cli,
+   boost::program_options::options_description& cfg
+   )
+{
+   cli.add_options()
+         ("operation-stream-history-blocks", boost::program_options::value< uint32_t >()->default_value( 1200 ), "Number of recent blocks kept in memory for operation stream subscribers resuming from an earlier block")
+         ("operation-stream-max-pending-blocks", boost::program_options::value< uint32_t >()->default_value( 200 ), "Number of undelivered blocks after which an operation stream subscriber is dropped")
+         ;
+   cfg.add(cli);
+}
+
+void operation_stream_plugin::plugin_initialize( const boost::program_options::variables_map& options )
+{
+   chain::database& db = database();
+
+   my->_history_blocks     = options.at( "operation-stream-history-blocks" ).as< uint32_t >();
+   my->_max_pending_blocks = options.at( "operation-stream-max-pending-blocks" ).as< uint32_t >();
+
+   protocol::operation op;
+   for( int64_t i = 0; i < protocol::operation::count(); ++i )
+   {
+      op.set_which( i );
+      my->_op_tags_by_name[ op.visit( detail::operation_name_visitor() ) ] = i;
+   }
+
+   my->_pre_apply_block_conn      = db.pre_apply_block.connect( [this]( const chain::signed_block& b ){ my->on_pre_apply_block( b ); } );
+   my->_post_apply_operation_conn = db.post_apply_operation.connect( [this]( const chain::operation_notification& note ){ my->on_operation( note ); } );
+   my->_applied_block_conn        = db.applied_block.connect( [this]( const chain::signed_block& b ){ my->on_applied_block( b ); } );
+   my->_popped_block_conn         = db.popped_block.connect( [this]( const chain::signed_block& b ){ my->on_popped_block( b ); } );
+}
+
+void operation_stream_plugin::plugin_startup()
+{
+   app().register_api_factory< operation_stream_api >( "operation_stream_api" );
+}
+
+void operation_stream_plugin::plugin_shutdown()
+{
+   {
+      std::lock_guard< std::mutex > lock( my->_mutex );
+      for( const auto& sub : my->_subscriptions )
+         sub->close();
+      my->_subscriptions.clear();
+   }
+   my->_delivery_thread.quit();
+}
+
+operation_subscription_ptr operation_stream_plugin::subscribe( const operation_stream_filter& filter, std::function< void( const fc::rpc::encoded_variant& ) > cb )
+{
+   auto sub = std::make_shared< detail::operation_subscription >();
+   sub->accounts = filter.accounts;
+   sub->dapps    = filter.dapps;
+   sub->callback = cb;
+   for( const auto& name : filter.operations )
+   {
+      auto itr = my->_op_tags_by_name.find( name );
+      FC_ASSERT( itr != my->_op_tags_by_name.end(), "Unknown operation ${o}", ("o",name) );
+      sub->op_tags.insert( itr->second );
+   }
+
+   // before _mutex, the write thread takes it while holding the write lock
+   chain::database& db = database();
+   uint32_t head_block_num = db.with_read_lock( [&]() { return db.head_block_num(); } );
+
+   std::lock_guard< std::mutex > lock( my->_mutex );
+   if( filter.start_block )
+   {
+      if( my->_history.size() )
+         head_block_num = std::max( head_block_num, my->_history.back().block->block_num );
+      FC_ASSERT( *filter.start_block <= head_block_num + 1, "Block ${b} has not been applied yet, the head block is ${h}",
+         ("b",*filter.start_block)("h",head_block_num) );
+      FC_ASSERT( my->_history.size() || *filter.start_block > head_block_num,
+         "Block ${b} is not available, no block has been recorded since the node started", ("b",*filter.start_block) );
+   }
+
+   if( filter.start_block && my->_history.size() )
+   {
+      uint32_t oldest = my->_history.front().block->block_num;
+      FC_ASSERT( *filter.start_block >= oldest, "Block ${b} is no longer available, oldest streamable block is ${o}",
+         ("b",*filter.start_block)("o",oldest) );
+
+      for( auto& rec : my->_history )
+      {
+         if( rec.block->block_num < *filter.start_block )
+            continue;
+         detail::encoded_results results;
+         auto msg = my->encode( rec, *sub, results );
+         if( msg.valid() )
+            my->push( sub, rec.block->block_num, msg, false );
+      }
+   }
+   my->_subscriptions.insert( sub );
+   return sub;
+}
+
+void operation_stream_plugin::unsubscribe( const operation_subscription_ptr& sub )
+{
+   if( !sub )
+      return;
+
+   std::lock_guard< std::mutex > lock( my->_mutex );
+   my->_subscriptions.erase( sub );
+   sub->close();
+}
+
+uint32_t operation_stream_plugin::get_oldest_block()const
+{
+   std::lock_guard< std::mutex > lock( my->_mutex );
+   return my->_history.empty() ? 0 : my->_history.front().block->block_num;
+}
+
+} } } // sigmaengine::plugin::operation_stream
+
+SIGMAENGINE_DEFINE_PLUGIN( operation_stream, sigmaengine::plugin::operation_stream::operation_stream_plugin )
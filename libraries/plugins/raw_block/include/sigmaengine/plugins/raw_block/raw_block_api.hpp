@@ -28,6 +28,27 @@ struct get_raw_block_result
    std::string                   raw_block;
 };
 
+struct get_raw_block_range_args
+{
+   uint32_t start_block = 0;               ///< first block to return, next_block of the previous chunk to resume
+   uint32_t max_blocks  = 10000;
+   uint32_t max_bytes   = 4*1024*1024;
+};
+
+/**
+ * Blocks are copied from the block log without being decoded. raw_blocks contains for every block its
+ * fc::raw packed signed_block followed by its 8 byte position in the log, block i starts at offsets[i].
+ * Only irreversible blocks are in the block log, last_block_in_log tells how far the range can be read.
+ */
+struct get_raw_block_range_result
+{
+   uint32_t                      start_block = 0;
+   uint32_t                      next_block = 0;
+   uint32_t                      last_block_in_log = 0;
+   std::vector< uint64_t >       offsets;
+   std::string                   raw_blocks;
+};
+
 class raw_block_api
 {
    public:
@@ -36,6 +57,7 @@ class raw_block_api
       void on_api_startup();
 
       get_raw_block_result get_raw_block( get_raw_block_args args );
+      get_raw_block_range_result get_raw_block_range( get_raw_block_range_args args );
       void push_raw_block( std::string block_b64 );
 
    private:
@@ -55,7 +77,22 @@ FC_REFLECT( sigmaengine::plugin::raw_block::get_raw_block_result,
    (raw_block)
    )
 
+FC_REFLECT( sigmaengine::plugin::raw_block::get_raw_block_range_args,
+   (start_block)
+   (max_blocks)
+   (max_bytes)
+   )
+
+FC_REFLECT( sigmaengine::plugin::raw_block::get_raw_block_range_result,
+   (start_block)
+   (next_block)
+   (last_block_in_log)
+   (offsets)
+   (raw_blocks)
+   )
+
 FC_API( sigmaengine::plugin::raw_block::raw_block_api,
    (get_raw_block)
+   (get_raw_block_range)
    (push_raw_block)
    )
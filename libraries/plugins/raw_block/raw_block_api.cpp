@@ -53,6 +53,31 @@ get_raw_block_result raw_block_api::get_raw_block( get_raw_block_args args )
    return result;
 }
 
+get_raw_block_range_result raw_block_api::get_raw_block_range( get_raw_block_range_args args )
+{
+   FC_ASSERT( args.start_block > 0 );
+   FC_ASSERT( args.max_blocks <= 10000 );
+   FC_ASSERT( args.max_bytes <= 16*1024*1024 );
+
+   get_raw_block_range_result result;
+   std::shared_ptr< sigmaengine::chain::database > db = my->app.chain_database();
+
+   std::vector< char > data;
+   uint32_t count = db->with_read_lock( [&]()
+   {
+      const chain::block_log& log = db->get_block_log();
+      if( log.head().valid() )
+         result.last_block_in_log = log.head()->block_num();
+      return log.read_raw_block_range( args.start_block, args.max_blocks, args.max_bytes, data, result.offsets );
+   });
+
+   result.start_block = args.start_block;
+   result.next_block = args.start_block + count;
+   if( data.size() )
+      result.raw_blocks = fc::base64_encode( (const unsigned char*)data.data(), data.size() );
+   return result;
+}
+
 void raw_block_api::push_raw_block( std::string block_b64 )
 {
    std::shared_ptr< sigmaengine::chain::database > db = my->app.chain_database();
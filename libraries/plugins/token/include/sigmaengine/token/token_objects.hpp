@@ -34,6 +34,9 @@ namespace sigmaengine { namespace token {
             c( *this );
          }
 
+         /// the symbol without its precision byte, no two tokens may share it
+         uint64_t symbol_name_key()const { return symbol >> 8; }
+
          id_type           id;
          token_name_type   name;
          uint64_t          symbol;
@@ -158,6 +161,7 @@ namespace sigmaengine { namespace token {
    
    struct by_name;
    struct by_symbol;
+   struct by_symbol_name;
    struct by_account_and_token;
    struct by_token;
    struct by_dapp_name;
@@ -177,7 +181,11 @@ namespace sigmaengine { namespace token {
             tag < by_symbol >,
             member < token_object, uint64_t, & token_object::symbol > 
          >,
-         ordered_non_unique <
+         ordered_unique <
+            tag < by_symbol_name >,
+            const_mem_fun < token_object, uint64_t, & token_object::symbol_name_key >
+         >,
+         ordered_unique <
             tag< by_dapp_name >,
             member< token_object, dapp_name_type, &token_object::dapp_name >
          >
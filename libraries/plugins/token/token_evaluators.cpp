@@ -31,12 +31,10 @@ namespace sigmaengine { namespace token {
                , ( "account", dapp_itr->owner) );
 
          const auto& index_by_dapp = _db.get_index< token_index >().indices().get< by_dapp_name >();
-            auto token_itr_by_dapp  = index_by_dapp.find( op.dapp_name );
-            FC_ASSERT( token_itr_by_dapp == index_by_dapp.end(), "\"${dapp name}\" dapp is already had a token.", ( "dapp name", op.dapp_name ) );
+         FC_ASSERT( index_by_dapp.find( op.dapp_name ) == index_by_dapp.end(), "\"${dapp name}\" dapp is already had a token.", ( "dapp name", op.dapp_name ) );
 
          const auto& token_name_idx = _db.get_index< token_index >().indices().get< by_name >();
-         auto token_name_itr = token_name_idx.find( op.name );
-         FC_ASSERT( token_name_itr == token_name_idx.end(), "${name} token is exist.", ( "name", op.name ) );
+         FC_ASSERT( token_name_idx.find( op.name ) == token_name_idx.end(), "${name} token is exist.", ( "name", op.name ) );
 
          uint64_t symbol = uint64_t(SIGMAENGINE_BLOCKCHAIN_PRECISION_DIGITS);
          string upper_symbol = boost::to_upper_copy( op.symbol_name );
@@ -52,15 +50,10 @@ namespace sigmaengine { namespace token {
          FC_ASSERT( upper_symbol != from_account.balance.symbol_name()
                , "Symbol can't use ${snac}.", ( "snac", from_account.balance.symbol_name() ) );
 
-         const auto& symbol_idx = _db.get_index< token_index >().indices().get< by_symbol >();
-         auto symbol_itr = symbol_idx.begin();
-
-         while( symbol_itr != symbol_idx.end() ) 
-         {
-            FC_ASSERT( symbol_itr->init_supply.symbol_name() != upper_symbol
-               , "${symbol} is already in use by another token.", ( "symbol", upper_symbol ) );
-            symbol_itr++;
-         }
+         // symbol names are unique regardless of precision
+         const auto& symbol_name_idx = _db.get_index< token_index >().indices().get< by_symbol_name >();
+         FC_ASSERT( symbol_name_idx.find( symbol >> 8 ) == symbol_name_idx.end()
+            , "${symbol} is already in use by another token.", ( "symbol", upper_symbol ) );
 
          asset init_supply = asset(0, symbol);
          init_supply.amount = op.init_supply_amount * init_supply.precision();
@@ -5,6 +5,7 @@
 #include <sigmaengine/token/util/token_util.hpp>
 
 #include <sigmaengine/chain/database.hpp>
+#include <sigmaengine/chain/due_objects.hpp>
 #include <sigmaengine/chain/index.hpp>
 #include <sigmaengine/chain/generic_custom_operation_interpreter.hpp>
 
@@ -26,6 +27,7 @@ namespace sigmaengine { namespace token {
             }
 
             void on_apply_block( const signed_block& b );
+            void check_token_symbols();
             void process_token_fund_withdraw();
             void process_token_savings_withdraws();
 
@@ -55,25 +57,25 @@ namespace sigmaengine { namespace token {
       void token_plugin_impl::process_token_fund_withdraw() {
          auto& _db = database();
          
-         const auto& idx = _db.get_index< token_fund_withdraw_index >().indices().get< by_complete >();
-         auto itr = idx.begin();
-         while( itr != idx.end() ) {
-            if( itr->complete > _db.head_block_time() )
-               break;
+         const auto now = _db.head_block_time();
+         util::token_util utils(_db);
 
+         process_due_objects< token_fund_withdraw_index, by_complete >( _db,
+            [&]( const token_fund_withdraw_object& w ) { return w.complete <= now; },
+            [&]( const token_fund_withdraw_object& w )
+         {
             dlog( "process_token_fund_withdraw : from = ${f}, token = ${t}, amount = ${a}, complete = ${c}"
-               , ("f", itr->from)("t", itr->token)("a", itr->amount)("c", itr->complete) );
+               , ("f", w.from)("t", w.token)("a", w.amount)("c", w.complete) );
 
-            util::token_util utils(_db);
-            utils.adjust_token_fund_balance( itr->token, itr->fund_name, -itr->amount, -itr->amount );
-            utils.adjust_token_balance( itr->from, itr->token, itr->amount);
+            utils.adjust_token_fund_balance( w.token, w.fund_name, -w.amount, -w.amount );
+            utils.adjust_token_balance( w.from, w.token, w.amount);
 
             _db.push_virtual_operation( fill_token_staking_fund_operation( 
-               itr->from, itr->token, itr->fund_name, itr->amount, itr->request_id, to_string(itr->memo) ) );
+               w.from, w.token, w.fund_name, w.amount, w.request_id, to_string(w.memo) ) );
 
-            _db.remove( *itr );
-            itr = idx.begin();
-         }
+            _db.remove( w );
+            return true;
+         });
       }
 
       void token_plugin_impl::process_token_savings_withdraws() {
@@ -120,6 +122,26 @@ namespace sigmaengine { namespace token {
          }
       }
 
+      /**
+       * by_symbol_name assumes every token keeps its symbol in init_supply and total_balance, checked once
+       * for the existing state since create_token no longer compares symbol names of all tokens.
+       */
+      void token_plugin_impl::check_token_symbols()
+      {
+         auto& _db = database();
+         _db.with_read_lock( [&]()
+         {
+            const auto& idx = _db.get_index< token_index >().indices().get< by_symbol_name >();
+            for( const auto& token : idx )
+            {
+               FC_ASSERT( token.init_supply.symbol == token.symbol && token.total_balance.symbol == token.symbol,
+                  "Symbol of ${name} token is inconsistent, replay the blockchain", ( "name", token.name )( "symbol", token.symbol )
+                  ( "init_supply", token.init_supply )( "total_balance", token.total_balance ) );
+            }
+            ilog( "Checked symbols of ${n} tokens", ( "n", idx.size() ) );
+         });
+      }
+
       void token_plugin_impl::on_apply_block( const signed_block& b ){
          process_token_fund_withdraw();
          process_token_savings_withdraws();
@@ -155,6 +177,7 @@ namespace sigmaengine { namespace token {
 
    void token_plugin::plugin_startup()
    {
+      _my->check_token_symbols();
       app().register_api_factory< token_api >( "token_api" );
    }
 
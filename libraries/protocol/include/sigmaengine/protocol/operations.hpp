@@ -4,6 +4,18 @@
 #include <sigmaengine/protocol/sigmaengine_operations.hpp>
 #include <sigmaengine/protocol/sigmaengine_virtual_operations.hpp>
 
+/**
+ * These operations are rare and much larger than the common ones, keeping them out of line
+ * makes every other operation (and every vector<operation> element) considerably smaller.
+ */
+namespace fc {
+   template<> struct static_variant_out_of_line< sigmaengine::protocol::account_create_operation > : std::true_type {};
+   template<> struct static_variant_out_of_line< sigmaengine::protocol::account_update_operation > : std::true_type {};
+   template<> struct static_variant_out_of_line< sigmaengine::protocol::request_account_recovery_operation > : std::true_type {};
+   template<> struct static_variant_out_of_line< sigmaengine::protocol::recover_account_operation > : std::true_type {};
+   template<> struct static_variant_out_of_line< sigmaengine::protocol::fill_transfer_token_savings_operation > : std::true_type {};
+}
+
 namespace sigmaengine { namespace protocol {
 
    /** NOTE: do not change the order of any operations prior to the virtual operations
@@ -7,32 +7,131 @@ namespace sigmaengine { namespace protocol {
 
 typedef std::function<authority(const string&)> authority_getter;
 
-struct sign_state
+/**
+ *  AuthorityGetter is any callable taking an account name and returning an authority-like
+ *  object (weight_threshold, key_auths and account_auths), either by value or by reference.
+ *  This allows the chain to check authorities stored in shared memory in place instead of
+ *  converting them to an authority on every lookup.
+ */
+template< typename AuthorityGetter >
+struct basic_sign_state
 {
       /** returns true if we have a signature for this key or can
        * produce a signature for this key, else returns false.
        */
       bool signed_by( const public_key_type& k );
-      bool check_authority( string id );
+      bool check_authority( const account_name_type& id );
+      bool check_authority( const string& id ) { return check_authority( account_name_type( id ) ); }
 
       /**
        *  Checks to see if we have signatures of the active authorites of
        *  the accounts specified in authority or the keys specified.
        */
-      bool check_authority( const authority& au, uint32_t depth = 0 );
+      template< typename AuthorityType >
+      bool check_authority( const AuthorityType& au, uint32_t depth = 0 );
 
       bool remove_unused_signatures();
 
-      sign_state( const flat_set<public_key_type>& sigs,
-                  const authority_getter& a,
-                  const flat_set<public_key_type>& keys );
+      basic_sign_state( const flat_set<public_key_type>& sigs,
+                        const AuthorityGetter& a,
+                        const flat_set<public_key_type>& keys );
 
-      const authority_getter&          get_active;
+      const AuthorityGetter&           get_active;
       const flat_set<public_key_type>& available_keys;
 
       flat_map<public_key_type,bool>   provided_signatures;
-      flat_set<string>                 approved_by;
+      flat_set<account_name_type>      approved_by;
       uint32_t                         max_recursion = SIGMAENGINE_MAX_SIG_CHECK_DEPTH;
 };
 
+typedef basic_sign_state< authority_getter > sign_state;
+
+template< typename AuthorityGetter >
+bool basic_sign_state< AuthorityGetter >::signed_by( const public_key_type& k )
+{
+   auto itr = provided_signatures.find(k);
+   if( itr == provided_signatures.end() )
+   {
+      auto pk = available_keys.find(k);
+      if( pk  != available_keys.end() )
+         return provided_signatures[k] = true;
+      return false;
+   }
+   return itr->second = true;
+}
+
+template< typename AuthorityGetter >
+bool basic_sign_state< AuthorityGetter >::check_authority( const account_name_type& id )
+{
+   if( approved_by.find(id) != approved_by.end() ) return true;
+   return check_authority( get_active(id) );
+}
+
+template< typename AuthorityGetter >
+template< typename AuthorityType >
+bool basic_sign_state< AuthorityGetter >::check_authority( const AuthorityType& auth, uint32_t depth )
+{
+   uint32_t total_weight = 0;
+   for( const auto& k : auth.key_auths )
+   {
+      if( signed_by( k.first ) )
+      {
+         total_weight += k.second;
+         if( total_weight >= auth.weight_threshold )
+            return true;
+      }
+   }
+
+   for( const auto& a : auth.account_auths )
+   {
+      if( approved_by.find(a.first) == approved_by.end() )
+      {
+         if( depth == max_recursion )
+            continue;
+         if( check_authority( get_active( a.first ), depth+1 ) )
+         {
+            approved_by.insert( a.first );
+            total_weight += a.second;
+            if( total_weight >= auth.weight_threshold )
+               return true;
+         }
+      }
+      else
+      {
+         total_weight += a.second;
+         if( total_weight >= auth.weight_threshold )
+            return true;
+      }
+   }
+   return total_weight >= auth.weight_threshold;
+}
+
+template< typename AuthorityGetter >
+bool basic_sign_state< AuthorityGetter >::remove_unused_signatures()
+{
+   vector<public_key_type> remove_sigs;
+   for( const auto& sig : provided_signatures )
+      if( !sig.second ) remove_sigs.push_back( sig.first );
+
+   for( auto& sig : remove_sigs )
+      provided_signatures.erase(sig);
+
+   return remove_sigs.size() != 0;
+}
+
+template< typename AuthorityGetter >
+basic_sign_state< AuthorityGetter >::basic_sign_state(
+   const flat_set<public_key_type>& sigs,
+   const AuthorityGetter& a,
+   const flat_set<public_key_type>& keys
+   ) : get_active(a), available_keys(keys)
+{
+   provided_signatures.reserve( sigs.size() );
+   for( const auto& key : sigs )
+      provided_signatures[ key ] = false;
+   approved_by.insert( "temp"  );
+}
+
+extern template struct basic_sign_state< authority_getter >;
+
 } } // sigmaengine::protocol
@@ -6,8 +6,32 @@
 #include <fc/exception/exception.hpp>
 #include <fc/io/raw.hpp>
 
+#include <array>
+
 namespace sigmaengine { namespace protocol {
 
+    namespace {
+       /**
+        * Recently encoded public keys.  API responses keep converting the keys of the same accounts and
+        * bobservers, a hit skips the checksum and base58 encoding.  Direct mapped on key bytes, which are
+        * uniformly distributed after the parity byte.
+        */
+       struct key_string_cache_entry
+       {
+          fc::ecc::public_key_data key;
+          std::string              str;
+       };
+
+       const size_t key_string_cache_size = 512;
+
+       key_string_cache_entry& key_string_cache_slot( const fc::ecc::public_key_data& key )
+       {
+          static thread_local std::array< key_string_cache_entry, key_string_cache_size > cache;
+          size_t slot = ( uint8_t( key.data[1] ) | ( uint8_t( key.data[2] ) << 8 ) ) % key_string_cache_size;
+          return cache[ slot ];
+       }
+    }
+
     public_key_type::public_key_type():key_data(){};
 
     public_key_type::public_key_type( const fc::ecc::public_key_data& data )
@@ -44,11 +68,17 @@ namespace sigmaengine { namespace protocol {
 
     public_key_type::operator std::string() const
     {
-       binary_key k;
-       k.data = key_data;
-       k.check = fc::ripemd160::hash( k.data.data, k.data.size() )._hash[0];
-       auto data = fc::raw::pack( k );
-       return SIGMAENGINE_ADDRESS_PREFIX + fc::to_base58( data.data(), data.size() );
+       auto& cached = key_string_cache_slot( key_data );
+       if( cached.str.empty() || cached.key != key_data )
+       {
+          binary_key k;
+          k.data = key_data;
+          k.check = fc::ripemd160::hash( k.data.data, k.data.size() )._hash[0];
+          auto data = fc::raw::pack( k );
+          cached.key = key_data;
+          cached.str = SIGMAENGINE_ADDRESS_PREFIX + fc::to_base58( data.data(), data.size() );
+       }
+       return cached.str;
     }
 
     bool operator == ( const public_key_type& p1, const fc::ecc::public_key& p2)
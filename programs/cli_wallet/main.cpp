@@ -34,6 +34,7 @@
 #include <fc/rpc/cli.hpp>
 #include <fc/rpc/http_api.hpp>
 #include <fc/rpc/websocket_api.hpp>
+#include <fc/rpc/binary_websocket_api.hpp>
 #include <fc/smart_ref_impl.hpp>
 
 #include <graphene/utilities/key_conversion.hpp>
@@ -177,7 +178,11 @@ void startOnlineWallet(wallet_data wdata, bpo::variables_map options, fc::path w
    fc::http::websocket_client client( options["cert-authority"].as<std::string>() );
    idump((wdata.ws_server));
    auto con  = client.connect( wdata.ws_server );
-   auto apic = std::make_shared<fc::rpc::websocket_api_connection>(*con);
+   std::shared_ptr<fc::rpc::websocket_api_connection> apic;
+   if( options.count("server-rpc-binary") )
+      apic = std::make_shared<fc::rpc::binary_websocket_api_connection>(*con);
+   else
+      apic = std::make_shared<fc::rpc::websocket_api_connection>(*con);
 
    auto remote_api = apic->get_remote_api< login_api >(1);
    edump((wdata.ws_user)(wdata.ws_password) );
@@ -306,6 +311,7 @@ int main( int argc, char** argv )
          ("server-rpc-endpoint,s", bpo::value<string>()->implicit_value("ws://127.0.0.1:5020"), "Server websocket RPC endpoint")
          ("server-rpc-user,u", bpo::value<string>(), "Server Username")
          ("server-rpc-password,p", bpo::value<string>(), "Server Password")
+         ("server-rpc-binary", "Talk to the server with fc::raw encoded binary frames, server-rpc-endpoint must be the server's rpc-binary-endpoint")
          ("cert-authority,a", bpo::value<string>()->default_value("_default"), "Trusted CA bundle file for connecting to wss:// TLS server")
          ("rpc-endpoint,r", bpo::value<string>()->implicit_value("127.0.0.1:5021"), "Endpoint for wallet websocket RPC to listen on")
          ("rpc-tls-endpoint,t", bpo::value<string>()->implicit_value("127.0.0.1:5022"), "Endpoint for wallet websocket TLS RPC to listen on")
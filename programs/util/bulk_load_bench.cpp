@@ -0,0 +1,285 @@
+/**
+ * Benchmark for chainbase::database::set_bulk_load() as used by database::reindex().
+ *
+ * Creates operation and account history like objects the way a replay does, operations in block
+ * order and history entries in sequence order of randomly chosen accounts, once with create() as
+ * usual and once while bulk loading.  Some operations are applied in an undo session the way custom
+ * operations are, with every other one failing and being undone.  Checks that no index is left with
+ * undo history and the revision can be set afterwards as reindex does, that every index ends up in
+ * the same order and every account with the same balance in both databases and prints the time per
+ * created object.  Also checks that squashing a session without undo history below it keeps the
+ * change and leaves no undo state behind.
+ *
+ * usage: bulk_load_bench [object_count] [account_count] [dir]
+ */
+
+#include <chainbase/chainbase.hpp>
+
+#include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace chainbase;
+using namespace boost::multi_index;
+
+struct by_id;
+struct by_location;
+struct by_account;
+
+class op_object : public chainbase::object< 1, op_object >
+{
+   public:
+      CHAINBASE_DEFAULT_CONSTRUCTOR( op_object )
+
+      id_type     id;
+      uint32_t    block = 0;
+      uint32_t    trx_in_block = 0;
+      uint16_t    op_in_trx = 0;
+};
+
+typedef shared_multi_index_container<
+   op_object,
+   indexed_by<
+      ordered_unique< tag< by_id >, member< op_object, op_object::id_type, &op_object::id > >,
+      ordered_unique< tag< by_location >,
+         composite_key< op_object,
+            member< op_object, uint32_t, &op_object::block >,
+            member< op_object, uint32_t, &op_object::trx_in_block >,
+            member< op_object, uint16_t, &op_object::op_in_trx >,
+            member< op_object, op_object::id_type, &op_object::id >
+         >
+      >
+   >
+> op_index;
+
+class history_object : public chainbase::object< 2, history_object >
+{
+   public:
+      CHAINBASE_DEFAULT_CONSTRUCTOR( history_object )
+
+      id_type     id;
+      uint64_t    account = 0;
+      uint32_t    sequence = 0;
+      uint32_t    block = 0;
+};
+
+typedef shared_multi_index_container<
+   history_object,
+   indexed_by<
+      ordered_unique< tag< by_id >, member< history_object, history_object::id_type, &history_object::id > >,
+      ordered_unique< tag< by_account >,
+         composite_key< history_object,
+            member< history_object, uint64_t, &history_object::account >,
+            member< history_object, uint32_t, &history_object::sequence >
+         >
+      >,
+      ordered_non_unique< tag< by_location >, member< history_object, uint32_t, &history_object::block > >
+   >
+> history_index;
+
+class balance_object : public chainbase::object< 3, balance_object >
+{
+   public:
+      CHAINBASE_DEFAULT_CONSTRUCTOR( balance_object )
+
+      id_type     id;
+      uint64_t    account = 0;
+      int64_t     balance = 0;
+};
+
+typedef shared_multi_index_container<
+   balance_object,
+   indexed_by<
+      ordered_unique< tag< by_id >, member< balance_object, balance_object::id_type, &balance_object::id > >,
+      ordered_unique< tag< by_account >, member< balance_object, uint64_t, &balance_object::account > >
+   >
+> balance_index;
+
+CHAINBASE_SET_INDEX_TYPE( op_object, op_index )
+CHAINBASE_SET_INDEX_TYPE( history_object, history_index )
+CHAINBASE_SET_INDEX_TYPE( balance_object, balance_index )
+
+/// seconds to create object_count objects of each type
+double replay( database& db, uint32_t object_count, uint32_t account_count, bool bulk_load )
+{
+   std::mt19937 rng( 1 );
+   std::vector< uint32_t > sequences( account_count );
+
+   for( uint64_t account = 0; account < account_count; ++account )
+      db.create< balance_object >( [&]( balance_object& b ) { b.account = account; } );
+
+   const auto& balances = db.get_index< balance_index >().indices().get< by_account >();
+
+   db.set_bulk_load( bulk_load );
+   auto start = std::chrono::steady_clock::now();
+   for( uint32_t i = 0; i < object_count; ++i )
+   {
+      uint32_t block = i / 64;
+
+      // a custom operation paying a fee and creating an object, every other one fails
+      if( i % 8 == 0 )
+      {
+         auto session = db.start_undo_session( true );
+         db.modify( *balances.find( rng() % account_count ), [&]( balance_object& b ) { b.balance -= 10; } );
+         db.create< op_object >( [&]( op_object& o )
+         {
+            o.block = block;
+            o.trx_in_block = ( i % 64 ) / 4;
+            o.op_in_trx = 4;
+         });
+         if( i % 16 )
+            session.squash();
+      }
+
+      db.create< op_object >( [&]( op_object& o )
+      {
+         o.block = block;
+         o.trx_in_block = ( i % 64 ) / 4;
+         o.op_in_trx = i % 4;
+      });
+
+      uint64_t account = rng() % account_count;
+      db.create< history_object >( [&]( history_object& h )
+      {
+         h.account = account;
+         h.sequence = ++sequences[ account ];
+         h.block = block;
+      });
+   }
+   double elapsed = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+   db.set_bulk_load( false );
+   return elapsed;
+}
+
+/// the replay opens no outer session, so it must leave no undo state in any index
+bool no_undo_history( database& db, int64_t revision )
+{
+   for( const auto& stats : db.get_index_statistics() )
+   {
+      if( stats.undo_states )
+      {
+         std::cerr << stats.type_name << " has " << stats.undo_states << " undo states\n";
+         return false;
+      }
+   }
+
+   try
+   {
+      db.set_revision( revision );
+   }
+   catch( const std::logic_error& e )
+   {
+      std::cerr << e.what() << "\n";
+      return false;
+   }
+   return db.revision() == revision;
+}
+
+/// squashes a change at revision 11 of a database without undo history, as reindex does for custom operations
+bool squash_without_history( database& db )
+{
+   const auto& balance = *db.get_index< balance_index >().indices().begin();
+   int64_t old_balance = balance.balance;
+
+   db.set_revision( 10 );
+   {
+      auto session = db.start_undo_session( true );
+      db.modify( balance, [&]( balance_object& b ) { b.balance += 1; } );
+      session.squash();
+   }
+
+   try
+   {
+      // throws if the squash left an undo state
+      db.set_revision( 11 );
+   }
+   catch( const std::logic_error& e )
+   {
+      std::cerr << e.what() << "\n";
+      return false;
+   }
+   db.undo_all();
+   bool kept = db.revision() == 11 && balance.balance == old_balance + 1;
+
+   db.modify( balance, [&]( balance_object& b ) { b.balance = old_balance; } );
+   return kept;
+}
+
+template< typename Tag, typename Index >
+bool same_order( const database& a, const database& b )
+{
+   const auto& ia = a.get_index< Index >().indices().template get< Tag >();
+   const auto& ib = b.get_index< Index >().indices().template get< Tag >();
+   return ia.size() == ib.size() && std::equal( ia.begin(), ia.end(), ib.begin(),
+      []( const typename Index::value_type& x, const typename Index::value_type& y ) { return x.id == y.id; } );
+}
+
+int main( int argc, char** argv )
+{
+   uint32_t object_count  = argc > 1 ? std::stoul( argv[1] ) : 1000000;
+   uint32_t account_count = argc > 2 ? std::stoul( argv[2] ) : 10000;
+   bfs::path dir          = argc > 3 ? bfs::path( argv[3] ) : bfs::temp_directory_path() / "bulk_load_bench";
+
+   uint64_t file_size = uint64_t( object_count ) * 512 + ( uint64_t( 64 ) << 20 );
+   double seconds[2];
+   database dbs[2];
+   for( int bulk_load = 0; bulk_load < 2; ++bulk_load )
+   {
+      database& db = dbs[ bulk_load ];
+      bfs::path db_dir = dir / ( bulk_load ? "bulk" : "normal" );
+      db.wipe( db_dir );
+      db.open( db_dir, database::read_write, file_size );
+      db.add_index< op_index >();
+      db.add_index< history_index >();
+      db.add_index< balance_index >();
+      seconds[ bulk_load ] = replay( db, object_count, account_count, bulk_load );
+      if( !no_undo_history( db, object_count / 64 ) )
+      {
+         std::cerr << "replay " << ( bulk_load ? "while bulk loading" : "with create()" ) << " left undo history\n";
+         return 1;
+      }
+   }
+
+   if( !same_order< by_id, op_index >( dbs[0], dbs[1] )
+       || !same_order< by_location, op_index >( dbs[0], dbs[1] )
+       || !same_order< by_id, history_index >( dbs[0], dbs[1] )
+       || !same_order< by_account, history_index >( dbs[0], dbs[1] )
+       || !same_order< by_location, history_index >( dbs[0], dbs[1] ) )
+   {
+      std::cerr << "indices differ between create() and bulk loading\n";
+      return 1;
+   }
+
+   const auto& balances0 = dbs[0].get_index< balance_index >().indices().get< by_account >();
+   const auto& balances1 = dbs[1].get_index< balance_index >().indices().get< by_account >();
+   if( !std::equal( balances0.begin(), balances0.end(), balances1.begin(),
+         []( const balance_object& a, const balance_object& b ) { return a.account == b.account && a.balance == b.balance; } ) )
+   {
+      std::cerr << "balances differ between create() and bulk loading\n";
+      return 1;
+   }
+
+   for( auto& db : dbs )
+   {
+      if( !squash_without_history( db ) )
+      {
+         std::cerr << "squashing a session without undo history lost the change or kept its undo state\n";
+         return 1;
+      }
+   }
+
+   for( auto& db : dbs )
+      db.close();
+   bfs::remove_all( dir );
+
+   std::cout << object_count << " objects of each type, " << account_count << " accounts:  create "
+             << std::fixed << std::setprecision( 0 ) << seconds[0] * 1e9 / object_count / 2 << " ns/object,  bulk load "
+             << seconds[1] * 1e9 / object_count / 2 << " ns/object\n";
+   return 0;
+}
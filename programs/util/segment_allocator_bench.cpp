@@ -0,0 +1,146 @@
+/**
+ * Benchmark for chainbase::size_class_allocator against bip::allocator, the segment manager.
+ *
+ * Applies the same allocation heavy blocks with both in a fresh segment each: every block creates
+ * objects with a string payload in a multi_index_container and keeps undo copies of the objects
+ * it modifies or removes in a map, as the undo state of a session does, edits the payload of
+ * some objects, removes the oldest ones and finally drops the undo copies as a commit does.
+ * Prints the time per block and the use of every size class of the pools.
+ *
+ * usage: segment_allocator_bench [blocks] [objects_per_block] [dir]
+ */
+
+#include <chainbase/chainbase.hpp>
+
+#include <boost/interprocess/containers/map.hpp>
+#include <boost/interprocess/containers/string.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+using namespace chainbase;
+using namespace boost::multi_index;
+
+template< template< typename > class Allocator >
+struct workload
+{
+   typedef bip::basic_string< char, std::char_traits< char >, Allocator< char > > string_type;
+
+   struct item
+   {
+      template< typename A >
+      item( uint64_t i, uint64_t o, const A& a ):id( i ),owner( o ),payload( a ){}
+
+      uint64_t      id = 0;
+      uint64_t      owner = 0;
+      string_type   payload;
+   };
+
+   struct by_id;
+   struct by_owner;
+
+   typedef multi_index_container<
+      item,
+      indexed_by<
+         ordered_unique< tag< by_id >, member< item, uint64_t, &item::id > >,
+         ordered_non_unique< tag< by_owner >, member< item, uint64_t, &item::owner > >
+      >,
+      Allocator< item >
+   > item_index;
+
+   typedef std::pair< const uint64_t, item > undo_value;
+   typedef bip::map< uint64_t, item, std::less< uint64_t >, Allocator< undo_value > > undo_map;
+
+   /// seconds to apply the blocks, done is called before the objects are destroyed
+   template< typename Done >
+   static double run( segment_manager* manager, uint32_t blocks, uint32_t per_block, Done&& done )
+   {
+      Allocator< item > a( manager );
+      item_index items( typename item_index::ctor_args_list(), a );
+      undo_map undo( std::less< uint64_t >(), a );
+      std::mt19937 rng( 1 );
+      uint64_t next_id = 0;
+
+      auto start = std::chrono::steady_clock::now();
+      for( uint32_t b = 0; b < blocks; ++b )
+      {
+         for( uint32_t i = 0; i < per_block; ++i )
+         {
+            auto itr = items.emplace( next_id++, rng() % 1000, a ).first;
+            items.modify( itr, [&]( item& o ) { o.payload.assign( 16 + rng() % 200, 'x' ); } );
+         }
+
+         // edits of recent objects, keeping the first value of each in the undo map
+         for( uint32_t i = 0; i < per_block / 2 && next_id; ++i )
+         {
+            auto itr = items.find( next_id - 1 - rng() % std::min< uint64_t >( next_id, per_block * 8 ) );
+            if( itr == items.end() )
+               continue;
+            undo.emplace( itr->id, *itr );
+            items.modify( itr, [&]( item& o ) { o.payload.append( 8 + rng() % 64, 'y' ); } );
+         }
+
+         // objects expire after a few blocks
+         while( items.size() > per_block * 8 )
+         {
+            auto itr = items.begin();
+            undo.emplace( itr->id, *itr );
+            items.erase( itr );
+         }
+
+         undo.clear();
+      }
+      double elapsed = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+      done();
+      return elapsed;
+   }
+};
+
+template< typename T >
+using segment_allocator = bip::allocator< T, segment_manager >;
+
+int main( int argc, char** argv )
+{
+   uint32_t blocks    = argc > 1 ? std::stoul( argv[1] ) : 2000;
+   uint32_t per_block = argc > 2 ? std::stoul( argv[2] ) : 1000;
+   bfs::path dir      = argc > 3 ? bfs::path( argv[3] ) : bfs::temp_directory_path() / "segment_allocator_bench";
+
+   uint64_t size = uint64_t( 1024 ) << 20;
+   bfs::create_directories( dir );
+   bfs::path file = dir / "segment.bin";
+
+   double seconds[2];
+   std::vector< size_class_statistics > classes;
+   for( int size_classes = 0; size_classes < 2; ++size_classes )
+   {
+      bfs::remove( file );
+      bip::managed_mapped_file segment( bip::create_only, file.generic_string().c_str(), size );
+      if( size_classes )
+      {
+         auto pools = segment.construct< size_class_pools >( bip::unique_instance )( segment.get_segment_manager() );
+         size_class_pools::segment_mapping_changed();
+         seconds[1] = workload< size_class_allocator >::run( segment.get_segment_manager(), blocks, per_block,
+            [&]() { classes = pools->get_statistics(); } );
+      }
+      else
+      {
+         seconds[0] = workload< segment_allocator >::run( segment.get_segment_manager(), blocks, per_block, [](){} );
+      }
+   }
+   bfs::remove_all( dir );
+
+   std::cout << blocks << " blocks of " << per_block << " objects:  segment manager "
+             << std::fixed << std::setprecision( 2 ) << seconds[0] * 1e3 / blocks << " ms/block,  size classes "
+             << seconds[1] * 1e3 / blocks << " ms/block\n\n";
+
+   std::cout << "  size     slabs      used      free  unused K  rounding K\n";
+   for( const auto& c : classes )
+      std::cout << std::setw( 6 ) << c.size << std::setw( 10 ) << c.slabs << std::setw( 10 ) << c.used_blocks
+                << std::setw( 10 ) << c.free_blocks << std::setw( 10 ) << c.unused_bytes / 1024
+                << std::setw( 12 ) << ( c.used_blocks * c.size - c.requested_bytes ) / 1024 << "\n";
+   return 0;
+}
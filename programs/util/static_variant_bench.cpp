@@ -0,0 +1,138 @@
+/**
+ * Micro-benchmark for fc::static_variant as used by sigmaengine::protocol::operation.
+ *
+ * Prints the footprint of operation and of every alternative (and whether it is stored out of
+ * line), then times visiting a block-like mix of operations with the jump-table visit() against
+ * a reference if-chain dispatch, which is how visit() used to work.
+ *
+ * usage: static_variant_bench [operation_count] [rounds]
+ */
+
+#include <sigmaengine/protocol/operations.hpp>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace sigmaengine::protocol;
+
+struct footprint_visitor
+{
+   typedef void result_type;
+
+   template< typename T >
+   void operator()( const T& )const
+   {
+      std::cout << std::setw( 6 ) << sizeof( T )
+                << ( fc::static_variant_out_of_line< T >::value ? "  out of line  " : "               " )
+                << fc::get_typename< T >::name() << "\n";
+   }
+};
+
+/// cheap visitor, so the benchmark measures dispatch and not the work done per operation
+struct sum_visitor
+{
+   typedef uint64_t result_type;
+
+   template< typename T >
+   uint64_t operator()( const T& )const { return sizeof( T ); }
+};
+
+template< int64_t N, typename... Ts >
+struct if_chain_dispatch;
+
+template< int64_t N >
+struct if_chain_dispatch< N >
+{
+   template< typename Visitor >
+   static typename Visitor::result_type apply( const operation& op, const Visitor& v )
+   {
+      FC_THROW_EXCEPTION( fc::assert_exception, "invalid tag" );
+   }
+};
+
+template< int64_t N, typename T, typename... Ts >
+struct if_chain_dispatch< N, T, Ts... >
+{
+   template< typename Visitor >
+   static typename Visitor::result_type apply( const operation& op, const Visitor& v )
+   {
+      if( op.which() == N ) return v( op.get< T >() );
+      return if_chain_dispatch< N + 1, Ts... >::apply( op, v );
+   }
+};
+
+template< typename... Ts >
+uint64_t if_chain_visit( const fc::static_variant< Ts... >& op, const sum_visitor& v )
+{
+   return if_chain_dispatch< 0, Ts... >::apply( op, v );
+}
+
+template< typename Function >
+double time_rounds( uint32_t rounds, Function&& f )
+{
+   auto start = std::chrono::steady_clock::now();
+   for( uint32_t i = 0; i < rounds; ++i )
+      f();
+   return std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+}
+
+int main( int argc, char** argv )
+{
+   try
+   {
+      size_t   count  = argc > 1 ? std::stoul( argv[1] ) : 1000000;
+      uint32_t rounds = argc > 2 ? std::stoul( argv[2] ) : 20;
+
+      std::cout << "sizeof(operation) = " << sizeof( operation ) << ", "
+                << operation::count() << " alternatives\n\n";
+
+      operation op;
+      for( int64_t i = 0; i < operation::count(); ++i )
+      {
+         op.set_which( i );
+         op.visit( footprint_visitor() );
+      }
+
+      // Mostly transfers and dapp custom json like real blocks, every 16th operation cycles through all alternatives.
+      std::vector< operation > ops( count );
+      for( size_t i = 0; i < count; ++i )
+      {
+         if( i % 16 == 15 )
+            ops[i].set_which( ( i / 16 ) % operation::count() );
+         else if( i % 2 )
+            ops[i] = custom_json_dapp_operation();
+         else
+            ops[i] = transfer_operation();
+      }
+
+      std::cout << "\nvector<operation> of " << count << " elements: "
+                << ( ops.size() * sizeof( operation ) ) / ( 1024 * 1024 ) << " MB inline storage\n\n";
+
+      uint64_t check_table = 0, check_chain = 0;
+      double table = time_rounds( rounds, [&]()
+      {
+         for( const auto& o : ops )
+            check_table += o.visit( sum_visitor() );
+      });
+      double chain = time_rounds( rounds, [&]()
+      {
+         for( const auto& o : ops )
+            check_chain += if_chain_visit( o, sum_visitor() );
+      });
+
+      FC_ASSERT( check_table == check_chain );
+
+      double visits = double( count ) * rounds;
+      std::cout << "jump table visit: " << std::setprecision( 3 ) << table * 1e9 / visits << " ns/op\n";
+      std::cout << "if chain visit:   " << std::setprecision( 3 ) << chain * 1e9 / visits << " ns/op\n";
+   }
+   catch( const fc::exception& e )
+   {
+      std::cerr << e.to_detail_string() << "\n";
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,200 @@
+/**
+ * Differential fuzzer and benchmark for sigmaengine::dapp::apply_utf8_patch.
+ *
+ * Applies random patches made by diff_match_patch, truncated and garbled patches and patches to
+ * texts which drifted from the one they were made against with both apply_utf8_patch and the
+ * std::wstring reference, and fails on the first difference in whether the patch was applied or in
+ * the result.  Then times applying a small edit to a large comment body with both.
+ *
+ * usage: utf8_patch_bench [fuzz_iterations] [body_kb] [seed]
+ */
+
+#include <sigmaengine/dapp/utf8_patch.hpp>
+
+#include <diff_match_patch.h>
+#include <boost/locale/encoding_utf.hpp>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace sigmaengine::dapp;
+
+typedef diff_match_patch< std::wstring > dmp_type;
+
+/// code points of every UTF-8 length, weighted towards words and whitespace like comment bodies
+static const std::vector< std::wstring > fragments = {
+   L"the ", L"quick ", L"brown ", L"fox ", L"jumps ", L"over ", L"lazy ", L"dog", L". ", L"\n", L"\n\n",
+   L"café ", L"über ", L"привет ", L"שלום ",
+   L"你好 ", L"日本語 ", L"한국어 ", L"€", L"—",
+   L"\U0001F600", L"\U0001F680 ", L"\U00010348", L"@@ ", L"%", L"+", L"-", L"\x01",
+};
+
+class fuzzer
+{
+   public:
+      explicit fuzzer( uint32_t seed ) : _rng( seed ) {}
+
+      std::wstring text( size_t fragment_count )
+      {
+         std::wstring result;
+         for( size_t i = 0; i < fragment_count; ++i )
+            result += fragments[ index( fragments.size() ) ];
+         return result;
+      }
+
+      /// a few random inserts, deletes and replacements
+      std::wstring mutate( std::wstring str, size_t edits )
+      {
+         for( size_t i = 0; i < edits; ++i )
+         {
+            size_t pos = index( str.size() + 1 );
+            size_t count = std::min( index( 12 ), str.size() - pos );
+            switch( index( 3 ) )
+            {
+               case 0:  str.insert( pos, text( 1 + index( 3 ) ) ); break;
+               case 1:  str.erase( pos, count ); break;
+               default: str.replace( pos, count, text( 1 ) ); break;
+            }
+         }
+         return str;
+      }
+
+      /// patch text which is malformed or not a patch at all
+      std::string garble( std::string str )
+      {
+         switch( index( 5 ) )
+         {
+            case 0:  return str.substr( 0, index( str.size() + 1 ) );
+            case 1:  if( str.size() ) str[ index( str.size() ) ] = char( index( 256 ) ); return str;
+            case 2:  return std::string( index( 3 ), '\n' ) + to_utf8( text( 1 + index( 8 ) ) );
+            case 3:  return "\xC3" + str;
+            default: str.insert( index( str.size() + 1 ), 1, char( 0x80 + index( 0x80 ) ) ); return str;
+         }
+      }
+
+      size_t index( size_t n ) { return n ? std::uniform_int_distribution< size_t >( 0, n - 1 )( _rng ) : 0; }
+
+      static std::string to_utf8( const std::wstring& str )
+      {
+         return boost::locale::conv::utf_to_utf< char >( str.c_str(), str.c_str() + str.size() );
+      }
+
+   private:
+      std::mt19937 _rng;
+};
+
+/// callers replace the text whether a patch is rejected by returning false or by throwing
+struct outcome
+{
+   bool        patched = false;
+   std::string result;
+
+   bool operator==( const outcome& o )const
+   {
+      return patched == o.patched && ( !patched || result == o.result );
+   }
+};
+
+template< typename Apply >
+outcome run( Apply apply, const std::string& patch, const std::string& text )
+{
+   outcome o;
+   try
+   {
+      o.patched = apply( patch, text, o.result );
+   }
+   catch( ... )
+   {
+      o.patched = false;
+   }
+   return o;
+}
+
+bool check( const std::string& patch, const std::string& text )
+{
+   outcome native = run( apply_utf8_patch, patch, text );
+   outcome reference = run( apply_wstring_patch, patch, text );
+   if( native == reference )
+      return true;
+
+   std::cerr << "mismatch\npatch: " << patch << "\ntext: " << text
+             << "\nnative:    patched " << native.patched << " " << native.result
+             << "\nreference: patched " << reference.patched << " " << reference.result << "\n";
+   return false;
+}
+
+template< typename Function >
+double time_rounds( uint32_t rounds, Function&& f )
+{
+   auto start = std::chrono::steady_clock::now();
+   for( uint32_t i = 0; i < rounds; ++i )
+      f();
+   return std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+}
+
+int main( int argc, char** argv )
+{
+   uint32_t iterations = argc > 1 ? std::stoul( argv[1] ) : 20000;
+   size_t   body_kb    = argc > 2 ? std::stoul( argv[2] ) : 1024;
+   uint32_t seed       = argc > 3 ? std::stoul( argv[3] ) : 1;
+
+   fuzzer f( seed );
+   dmp_type dmp;
+
+   for( uint32_t i = 0; i < iterations; ++i )
+   {
+      std::wstring original = f.text( f.index( 200 ) );
+      std::wstring edited = f.mutate( original, 1 + f.index( 6 ) );
+      std::string patch = fuzzer::to_utf8( dmp.patch_toText( dmp.patch_make( original, edited ) ) );
+
+      // the text the patch was made against, one which drifted away from it and an unrelated one
+      if( !check( patch, fuzzer::to_utf8( original ) )
+          || !check( patch, fuzzer::to_utf8( f.mutate( original, 1 + f.index( 10 ) ) ) )
+          || !check( patch, fuzzer::to_utf8( f.text( f.index( 100 ) ) ) )
+          || !check( f.garble( patch ), fuzzer::to_utf8( original ) ) )
+         return 1;
+
+      // bodies which are not valid UTF-8
+      std::string invalid = fuzzer::to_utf8( original );
+      invalid.insert( f.index( invalid.size() + 1 ), 1, char( 0x80 + f.index( 0x80 ) ) );
+      if( !check( patch, invalid ) )
+         return 1;
+   }
+   std::cout << iterations << " fuzz iterations without a difference\n";
+
+   // a typo fix in the middle and an appended paragraph of a large body, exact and drifted
+   std::wstring body;
+   while( body.size() * 2 < body_kb * 1024 )
+      body += f.text( 100 );
+   std::wstring edited = body;
+   edited.replace( edited.size() / 2, 5, L"typo fixed é你\U0001F600" );
+   edited += L"\n\nEDIT: thanks for the feedback \U0001F680";
+   std::string patch = fuzzer::to_utf8( dmp.patch_toText( dmp.patch_make( body, edited ) ) );
+
+   std::wstring drifted = body;
+   drifted.insert( body.size() / 4, L"inserted by someone else " );
+
+   const std::pair< const char*, std::string > bodies[] = {
+      { "exact",   fuzzer::to_utf8( body ) },
+      { "drifted", fuzzer::to_utf8( drifted ) },
+   };
+   for( const auto& b : bodies )
+   {
+      if( !check( patch, b.second ) )
+         return 1;
+
+      const uint32_t rounds = 20;
+      std::string result;
+      double native = time_rounds( rounds, [&]() { apply_utf8_patch( patch, b.second, result ); } );
+      double reference = time_rounds( rounds, [&]() { apply_wstring_patch( patch, b.second, result ); } );
+
+      std::cout << b.second.size() / 1024 << " KB body, " << b.first << " match:  utf8 "
+                << std::setprecision( 3 ) << native * 1e3 / rounds << " ms/patch,  wstring "
+                << std::setprecision( 3 ) << reference * 1e3 / rounds << " ms/patch\n";
+   }
+   return 0;
+}